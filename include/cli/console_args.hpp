@@ -1,6 +1,10 @@
 #pragma once
 
 #include <cli/type_parser.hpp>
+#include <render/field_renderer.hpp>
+#include <cstdint>
+#include <optional>
+#include <simulation/common.hpp>
 #include <string>
 
 struct ConsoleArgs {
@@ -13,22 +17,61 @@ struct ConsoleArgs {
 
     // dir for saves
     std::string saveDir = "./save";
+    // save dir is given, batch run saves states only then
+    bool hasSaveDir = false;
     // file to load save
     std::string saveFile;
+    // dir of saves or frame log to replay instead of simulation
+    std::string replayPath;
+    // file with list of simulations to run concurrently
+    std::string jobsFile;
+    // tick to start replay from
+    unsigned seekTick = 0;
     // save rate (in ticks)
     unsigned saveRate = 100;
+    // every fullSaveRate-th save is full, others are deltas from previous
+    unsigned fullSaveRate = 1;
 
     // max simulation iterations (iteration != tick)
     unsigned maxIterations = 10000;
     // don't print simulation field to stdout each tick
     bool quiet = false;
+    // format of printed fields
+    RenderMode renderMode = RenderMode::full;
+    // print fields in separate thread
+    bool asyncRender = false;
+    // file to record fields of ticks to instead of printing them
+    std::string frameLog;
+    // print profile of simulation every profileRate ticks, 0 to disable
+    unsigned profileRate = 0;
+    // run without prompt and rendering, print summary at the end
+    bool batch = false;
+    // max steps of batch run or of each job (step != tick), 0 for no limit
+    uint64_t maxSteps = 0;
+    // wall-clock budget of simulation (in seconds), 0 for no budget
+    double timeLimit = 0;
+    // choose types by short runs of each compiled in combination
+    bool autoTypes = false;
+    // steps of each run of auto-tuning
+    unsigned tuneSteps = 50;
+    // max share of cells, which may differ from FIXED(64, 32) after tuning
+    // steps
+    double tuneTolerance = 0.02;
+    // file to cache chosen types, no cache if empty
+    std::string tuneCache;
+    // seed of random moves, seed of loaded state is kept if it isn't given
+    std::optional<uint64_t> seed;
 
     // number of threads for parallel computation
     unsigned threads = 1;
+    // algorithm of flow propagation
+    FlowSolver flowSolver = FlowSolver::recursive;
 
     /// @brief Validate console args.
     /// @return result of validation and message, if not successful.
     std::pair<bool, std::string> validate();
 };
 
-ConsoleArgs parseConsoleArguments(int argc, char* argv[]);
\ No newline at end of file
+ConsoleArgs parseConsoleArguments(int argc, char* argv[]);
+
+FlowSolver parseFlowSolver(const std::string& str);
\ No newline at end of file
@@ -0,0 +1,10 @@
+#pragma once
+
+#include <istream>
+#include <simulation/runner.hpp>
+#include <vector>
+
+/// @brief Parse list of jobs, one job per line:
+/// <input file> <p type> <v type> <v flow type> <ticks>.
+/// Empty lines and lines starting with '#' are skipped.
+std::vector<SimulationJob> parseSimulationJobs(std::istream& in);
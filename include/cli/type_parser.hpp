@@ -3,4 +3,6 @@
 #include <string>
 #include <types/type.hpp>
 
+/// @brief Parse DOUBLE, FLOAT, FIXED(n, k), FAST_FIXED(n, k),
+/// SAT_FIXED(n, k) or MIXED(<store type>, <accumulator type>).
 Type parseType(std::string str);
@@ -0,0 +1,93 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <iostream>
+#include <mutex>
+#include <simulation/common.hpp>
+#include <string>
+#include <thread>
+#include <vector>
+
+/// @brief Format of rendered frames.
+enum class RenderMode {
+    // "Tick N" line and all rows of field
+    full,
+    // only changed cells with ANSI cursor positioning
+    diff
+};
+
+/// @brief Renders ticks of simulation to stream.
+/// Each frame is built in one preallocated buffer and written at once.
+/// If renderer is async, frames are built and written by separate thread
+/// in order of calls, caller waits only if maxPending frames are queued.
+/// All output to stream must go through renderer, while it's alive.
+class FieldRenderer {
+public:
+    struct Stats {
+        uint64_t frames = 0;
+        uint64_t bytes = 0;
+        // building and writing of frames
+        std::chrono::nanoseconds renderTime{0};
+    };
+
+    FieldRenderer(std::ostream& out, RenderMode mode, bool async = false);
+    FieldRenderer(const FieldRenderer&) = delete;
+    /// @brief Render queued frames and stop thread.
+    ~FieldRenderer();
+
+    /// @brief Render tick with field. Field is copied, so it can be
+    /// changed after call.
+    void render(unsigned tick, const DynamicMatrix<char>& field);
+    /// @brief Render tick without field.
+    void render(unsigned tick);
+    /// @brief Print line of text after last frame.
+    void print(const std::string& line);
+    /// @brief Wait until all frames are written.
+    void flush();
+
+    Stats getStats();
+
+private:
+    struct Frame {
+        unsigned tick = 0;
+        bool hasField = false;
+        // frame is line of text
+        bool hasLine = false;
+        DynamicMatrix<char> field;
+        std::string line;
+    };
+
+    static constexpr size_t maxPending = 4;
+
+    std::ostream& out;
+    const RenderMode mode;
+    const bool async;
+
+    std::string buffer;
+    // last rendered field for diff mode
+    DynamicMatrix<char> previous;
+    bool hasPrevious = false;
+    Stats stats;
+
+    std::deque<Frame> pending;
+    // frames for reuse of memory
+    std::vector<Frame> freeFrames;
+    bool isBusy = false;
+    bool isStopped = false;
+    std::mutex mutex;
+    std::condition_variable condition;
+    std::thread thread;
+
+    /// @brief Get frame for filling, waits if too many frames are pending.
+    Frame takeFrame();
+    void push(Frame&& frame);
+    void run();
+    void write(const Frame& frame);
+    void buildFull(const Frame& frame);
+    void buildDiff(const Frame& frame);
+    void appendNumber(uint64_t value);
+    void moveCursor(size_t row, size_t column);
+};
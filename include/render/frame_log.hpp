@@ -0,0 +1,114 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <fstream>
+#include <mutex>
+#include <simulation/common.hpp>
+#include <string>
+#include <thread>
+#include <vector>
+
+/// @brief Header of frame log.
+/// Header is followed by frames, each frame is FrameLogRecord and
+/// difference of field from field of previous frame (see
+/// encodeDifference), field before first frame is filled with zero bytes.
+struct FrameLogHeader {
+    static constexpr char signature[8] = {'F', 'L', 'U', 'I',
+                                          'D', 'F', 'R', 'M'};
+    static constexpr uint32_t currentVersion = 1;
+    static constexpr uint32_t byteOrderTag = 0x01020304;
+
+    char magic[8];
+    uint32_t version;
+    uint32_t byteOrder;
+    uint64_t height, width;
+};
+
+struct FrameLogRecord {
+    uint32_t tickCount;
+    uint32_t reserved;
+    // size of encoded difference
+    uint64_t size;
+};
+
+/// @brief Writes fields of ticks to frame log in background thread.
+/// Frames are encoded and written in order of calls, caller waits only if
+/// maxPending frames are queued.
+class FrameLogWriter {
+public:
+    struct Stats {
+        uint64_t frames = 0;
+        // size of log
+        uint64_t bytes = 0;
+        // waiting for queued frames
+        std::chrono::nanoseconds waitTime{0};
+    };
+
+    explicit FrameLogWriter(const std::string& path);
+    FrameLogWriter(const FrameLogWriter&) = delete;
+    /// @brief Write queued frames and stop thread.
+    /// Errors of writes aren't reported, call flush to get them.
+    ~FrameLogWriter();
+
+    /// @brief Write field of tick. Field is copied, so it can be changed
+    /// after call. All fields must have same size.
+    /// Rethrows error of previous write, if any.
+    void write(unsigned tick, const DynamicMatrix<char>& field);
+    /// @brief Wait until all frames are written.
+    /// Rethrows error of write, if any.
+    void flush();
+
+    Stats getStats();
+
+private:
+    struct Frame {
+        unsigned tick = 0;
+        DynamicMatrix<char> field;
+    };
+
+    static constexpr size_t maxPending = 4;
+
+    std::ofstream out;
+    std::string buffer;
+    // field of last written frame
+    DynamicMatrix<char> previous;
+    bool hasHeader = false;
+    Stats stats;
+
+    std::deque<Frame> pending;
+    // frames for reuse of memory
+    std::vector<Frame> freeFrames;
+    bool isBusy = false;
+    bool isStopped = false;
+    std::exception_ptr error;
+    std::mutex mutex;
+    std::condition_variable condition;
+    std::thread thread;
+
+    void run();
+    void writeFrame(const Frame& frame);
+};
+
+/// @brief Reads frames of frame log one by one.
+class FrameLogReader {
+public:
+    explicit FrameLogReader(const std::string& path);
+
+    /// @brief Read next frame.
+    /// @return false, if log has ended.
+    bool next();
+
+    unsigned getTickCount() const { return tickCount; }
+    /// @brief Field of current frame.
+    const DynamicMatrix<char>& getField() const { return field; }
+
+private:
+    std::ifstream in;
+    std::string buffer;
+    unsigned tickCount = 0;
+    DynamicMatrix<char> field;
+};
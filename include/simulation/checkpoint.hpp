@@ -0,0 +1,63 @@
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <simulation/common.hpp>
+#include <simulation/interface.hpp>
+#include <thread>
+
+/// @brief Writes snapshots of simulation state in background thread.
+/// Snapshot is taken into one of two reusable buffers, while other buffer
+/// may be written. If previous snapshot isn't written yet, save waits for
+/// it (back-pressure), so at most one write is in progress.
+class CheckpointWriter {
+public:
+    using WriteFunc = std::function<void(const FluidSimulationState&)>;
+
+    /// @brief Time, that tick loop was blocked by checkpoints.
+    struct Stats {
+        unsigned saves = 0;
+        // copying state into buffer
+        std::chrono::nanoseconds snapshotTime{0};
+        // waiting for previous write
+        std::chrono::nanoseconds waitTime{0};
+    };
+
+    explicit CheckpointWriter(WriteFunc write);
+    CheckpointWriter(const CheckpointWriter&) = delete;
+    /// @brief Wait for last write and stop background thread.
+    /// Errors of writes aren't reported, call flush to get them.
+    ~CheckpointWriter();
+
+    /// @brief Take snapshot of simulation and write it in background.
+    /// Rethrows error of previous write, if any.
+    void save(const FluidSimulationInterface& simulation);
+    /// @brief Wait until all snapshots are written.
+    /// Rethrows error of write, if any.
+    void flush();
+
+    Stats getStats() const { return stats; }
+
+private:
+    WriteFunc write;
+    std::array<FluidSimulationState, 2> buffers;
+    // buffer, that is written or waits for writing
+    int pending = -1;
+    // buffer for next snapshot
+    int next = 0;
+    bool isStopped = false;
+    std::exception_ptr error;
+    Stats stats;
+
+    std::mutex mutex;
+    std::condition_variable condition;
+    std::thread thread;
+
+    void run();
+    /// @brief Wait until pending buffer is written.
+    void waitPending(std::unique_lock<std::mutex>& lock);
+};
@@ -1,10 +1,16 @@
 #pragma once
 
+#include <algorithm>
 #include <array>
+#include <cstdint>
+#include <memory>
 #include <types/fixed.hpp>
+#include <utility>
 #include <vector>
 
 constexpr unsigned rhoSize = 256;
+// seed of random moves, if it isn't given
+constexpr uint64_t defaultSeed = 1337;
 constexpr std::array<std::pair<int, int>, 4> deltas{
     {{-1, 0}, {1, 0}, {0, -1}, {0, 1}}};
 
@@ -17,17 +23,90 @@ constexpr size_t getDeltaIndex(int dx, int dy) {
     return deltas.size();
 }
 
-template <typename T, size_t N, size_t M>
-using StaticMatrix = T[N][M];
+/// @brief Algorithm of flow propagation.
+enum class FlowSolver {
+    // recursive search of flow
+    recursive,
+    // search with explicit stack, same results as recursive
+    iterative,
+    // iterative search in bands of rows concurrently, then in whole field
+    parallel
+};
 
+/// @brief Matrix in one row-major buffer.
+/// Cells are owned by matrix or by external storage (e.g. mapped file).
+/// Copy of matrix always owns its cells.
 template <typename T>
-using DynamicMatrix = std::vector<std::vector<T>>;
+class DynamicMatrix {
+public:
+    DynamicMatrix() = default;
+
+    DynamicMatrix(size_t height, size_t width, const T& value = T())
+        : height(height),
+          width(width),
+          owned(height * width, value),
+          cells(owned.data()) {}
+
+    /// @brief Matrix over cells, that are kept alive by storage.
+    DynamicMatrix(size_t height, size_t width, T* cells,
+                  std::shared_ptr<void> storage)
+        : height(height),
+          width(width),
+          cells(cells),
+          storage(std::move(storage)) {}
+
+    DynamicMatrix(const DynamicMatrix& other)
+        : height(other.height),
+          width(other.width),
+          owned(other.cells, other.cells + other.size()),
+          cells(owned.data()) {}
+
+    DynamicMatrix(DynamicMatrix&& other) noexcept
+        : height(std::exchange(other.height, 0)),
+          width(std::exchange(other.width, 0)),
+          owned(std::move(other.owned)),
+          cells(std::exchange(other.cells, nullptr)),
+          storage(std::move(other.storage)) {}
+
+    DynamicMatrix& operator=(DynamicMatrix other) noexcept {
+        std::swap(height, other.height);
+        std::swap(width, other.width);
+        std::swap(owned, other.owned);
+        std::swap(cells, other.cells);
+        std::swap(storage, other.storage);
+        return *this;
+    }
+
+    T* operator[](size_t x) { return cells + x * width; }
+    const T* operator[](size_t x) const { return cells + x * width; }
 
-template <typename T, size_t N, size_t M>
-using StaticVectorMatrix = StaticMatrix<std::array<T, deltas.size()>, N, M>;
+    T* data() { return cells; }
+    const T* data() const { return cells; }
 
+    size_t getHeight() const { return height; }
+    size_t getWidth() const { return width; }
+    size_t size() const { return height * width; }
+
+    /// @brief Copy cells of other matrix, reusing memory, if it has same
+    /// size.
+    void assign(const DynamicMatrix& other) {
+        if (height != other.height || width != other.width) {
+            *this = other;
+            return;
+        }
+        std::copy_n(other.cells, size(), cells);
+    }
+
+private:
+    size_t height = 0, width = 0;
+    std::vector<T> owned;
+    T* cells = nullptr;
+    std::shared_ptr<void> storage;
+};
+
+/// @brief Separate matrix for each direction of deltas.
 template <typename T>
-using DynamicVectorMatrix = DynamicMatrix<std::array<T, deltas.size()>>;
+using DynamicVectorMatrix = std::array<DynamicMatrix<T>, deltas.size()>;
 
 /// @brief State of fluid simulation.
 struct FluidSimulationState {
@@ -35,28 +114,29 @@ struct FluidSimulationState {
     std::array<Fixed<>, rhoSize> rho;
     DynamicMatrix<char> field;
     DynamicMatrix<Fixed<>> p;
+    // velocity[k][x][y] is velocity from (x, y) in direction deltas[k]
     DynamicVectorMatrix<Fixed<>> velocity;
     DynamicMatrix<int> lastUse;
     DynamicMatrix<int> dirs;
     int UT = 0;
     unsigned tickCount = 0;
+    uint64_t seed = defaultSeed;
 
     explicit FluidSimulationState() = default;
 
-    explicit FluidSimulationState(size_t height, size_t width) {
-        field.resize(height, std::vector<char>(width));
-        p.resize(height, std::vector<Fixed<>>(width));
-        dirs.resize(height, std::vector<int>(width, 0));
-        lastUse.resize(height, std::vector<int>(width, 0));
-        velocity.resize(height,
-                        std::vector<std::array<Fixed<>, deltas.size()>>(
-                            width, std::array<Fixed<>, deltas.size()>()));
+    explicit FluidSimulationState(size_t height, size_t width)
+        : field(height, width),
+          p(height, width),
+          lastUse(height, width),
+          dirs(height, width) {
+        for (auto& plane : velocity) {
+            plane = DynamicMatrix<Fixed<>>(height, width);
+        }
     }
 
     explicit FluidSimulationState(DynamicMatrix<char>&& initialField)
-        : FluidSimulationState(initialField.size(), initialField.size() > 0
-                                                        ? initialField[0].size()
-                                                        : 0) {
+        : FluidSimulationState(initialField.getHeight(),
+                               initialField.getWidth()) {
         field = std::move(initialField);
         for (size_t x = 0; x < getFieldHeight(); ++x) {
             for (size_t y = 0; y < getFieldWidth(); ++y) {
@@ -69,8 +149,6 @@ struct FluidSimulationState {
         }
     }
 
-    size_t getFieldHeight() const { return field.size(); }
-    size_t getFieldWidth() const {
-        return field.size() > 0 ? field[0].size() : 0;
-    }
+    size_t getFieldHeight() const { return field.getHeight(); }
+    size_t getFieldWidth() const { return field.getWidth(); }
 };
@@ -0,0 +1,24 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+/// @brief Append varint (7 bits per byte, low bits first) to out.
+void putVarint(std::string& out, uint64_t value);
+
+/// @brief Read varint from [p, end) and move p after it.
+/// @return false, if varint isn't complete.
+bool getVarint(const char*& p, const char* end, uint64_t& value);
+
+/// @brief Append difference of a from b (both of given size) to out.
+/// Difference is bytes of a xor bytes of b, encoded as sequence of
+/// (count of zero bytes, count of next bytes, next bytes) with varint
+/// counts, so equal parts cost few bytes.
+void encodeDifference(const char* a, const char* b, size_t size,
+                      std::string& out);
+
+/// @brief Apply difference [p, end) to data, so data of b becomes data of a.
+/// @return false, if difference is corrupted.
+bool applyDifference(char* data, size_t size, const char* p,
+                     const char* end);
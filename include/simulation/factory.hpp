@@ -1,14 +1,11 @@
 #pragma once
 
-#include <array>
-#include <functional>
 #include <memory>
+#include <simulation/common.hpp>
 #include <simulation/interface.hpp>
-#include <simulation/simulation.hpp>
-#include <tuple>
-#include <types/fast_fixed.hpp>
-#include <types/fixed.hpp>
 #include <types/type.hpp>
+#include <utility>
+#include <vector>
 
 /// @brief contains all data for fluid simulation initialization.
 struct FactoryContext {
@@ -16,163 +13,32 @@ struct FactoryContext {
     Type pType, velocityType, velocityFlowType;
 
     unsigned threads = 1;
+    FlowSolver flowSolver = FlowSolver::recursive;
     FluidSimulationState initialState;
+    // print used types and field to stdout
+    bool verbose = true;
 };
 
-namespace factories {
-
-/*
-Layer factory architecture.
-Each factory transform one dynamic argument into static argument
-and call next factory with all earlier transformed static arguments.
-*/
-
-using Factory = std::function<std::unique_ptr<FluidSimulationInterface>(
-    const FactoryContext&)>;
-
-namespace StaticFieldFactory {
-template <typename PType, typename VelocityType, typename VelocityFlowType,
-          size_t Height, size_t Width>
-std::unique_ptr<FluidSimulationInterface> create(const FactoryContext& ctx) {
-    std::cout << "Used static field(" << Height << ", " << Width << ")"
-              << std::endl;
-    return std::make_unique<
-        FluidSimulation<PType, VelocityType, VelocityFlowType, Height, Width>>(
-        ctx.initialState, ctx.threads);
-}
-}  // namespace StaticFieldFactory
-
-namespace SizeFactory {
-template <typename PType, typename VelocityType, typename VelocityFlowType>
-std::unique_ptr<FluidSimulationInterface> create(const FactoryContext& ctx) {
-#define S(height, width)                                                  \
-    std::make_tuple(                                                      \
-        height, width,                                                    \
-        StaticFieldFactory::create<PType, VelocityType, VelocityFlowType, \
-                                   height, width>)
-
-    static const std::tuple<size_t, size_t, Factory> factories[] = {SIZES};
-
-#undef S
-
-    for (const auto& [height, width, factory] : factories) {
-        if (ctx.height == height && ctx.width == width) {
-            return factory(ctx);
-        }
-    }
-
-    std::cout << "Used dynamic field(" << ctx.height << ", " << ctx.width << ")"
-              << std::endl;
-    return std::make_unique<
-        FluidSimulation<PType, VelocityType, VelocityFlowType>>(
-        ctx.initialState, ctx.threads);
-}
-}  // namespace SizeFactory
-
-namespace VelocityFlowTypeFactory {
-template <typename PType, typename VelocityType>
-std::unique_ptr<FluidSimulationInterface> create(const FactoryContext& ctx) {
-#define DOUBLE \
-    { doubleType(), SizeFactory::create<PType, VelocityType, double> }
-#define FLOAT \
-    { floatType(), SizeFactory::create<PType, VelocityType, float> }
-#define FIXED(n, k) \
-    { fixedType(n, k), SizeFactory::create<PType, VelocityType, Fixed<n, k>> }
-#define FAST_FIXED(n, k)                                              \
-    {                                                                 \
-        fastFixedType(n, k),                                          \
-            SizeFactory::create<PType, VelocityType, FastFixed<n, k>> \
-    }
-
-    static const std::pair<Type, Factory> factories[] = {TYPES};
-
-#undef DOUBLE
-#undef FLOAT
-#undef FIXED
-#undef FAST_FIXED
-
-    for (const auto& [type, factory] : factories) {
-        if (ctx.velocityFlowType == type) {
-            std::cout << "VFlowType used: " << to_string(ctx.velocityFlowType)
-                      << std::endl;
-            return factory(ctx);
-        }
-    }
-    throw std::invalid_argument("Unsupported velocity flow type.");
-}
-}  // namespace VelocityFlowTypeFactory
-
-namespace VelocityTypeFactory {
-template <typename PType>
-std::unique_ptr<FluidSimulationInterface> create(const FactoryContext& ctx) {
-#define DOUBLE \
-    { doubleType(), VelocityFlowTypeFactory::create<PType, double> }
-#define FLOAT \
-    { floatType(), VelocityFlowTypeFactory::create<PType, float> }
-#define FIXED(n, k) \
-    { fixedType(n, k), VelocityFlowTypeFactory::create<PType, Fixed<n, k>> }
-#define FAST_FIXED(n, k)                                            \
-    {                                                               \
-        fastFixedType(n, k),                                        \
-            VelocityFlowTypeFactory::create<PType, FastFixed<n, k>> \
-    }
-
-    static const std::pair<Type, Factory> factories[] = {TYPES};
-
-#undef DOUBLE
-#undef FLOAT
-#undef FIXED
-#undef FAST_FIXED
-
-    for (const auto& [type, factory] : factories) {
-        if (ctx.velocityType == type) {
-            std::cout << "VType used: " << to_string(ctx.velocityType)
-                      << std::endl;
-            return factory(ctx);
-        }
-    }
-    throw std::invalid_argument("Unsupported velocity type.");
-}
-}  // namespace VelocityTypeFactory
-
-namespace PTypeFactory {
-std::unique_ptr<FluidSimulationInterface> create(const FactoryContext& ctx) {
-#define DOUBLE \
-    { doubleType(), VelocityTypeFactory::create<double> }
-#define FLOAT \
-    { floatType(), VelocityTypeFactory::create<float> }
-#define FIXED(n, k) \
-    { fixedType(n, k), VelocityTypeFactory::create<Fixed<n, k>> }
-#define FAST_FIXED(n, k) \
-    { fastFixedType(n, k), VelocityTypeFactory::create<FastFixed<n, k>> }
-
-    static const std::pair<Type, Factory> factories[] = {TYPES};
-
-#undef DOUBLE
-#undef FLOAT
-#undef FIXED
-#undef FAST_FIXED
-
-    for (const auto& [type, factory] : factories) {
-        if (ctx.pType == type) {
-            std::cout << "PType used: " << to_string(ctx.pType) << std::endl;
-            return factory(ctx);
-        }
-    }
-    throw std::invalid_argument("Unsupported p type.");
-}
-}  // namespace PTypeFactory
-
-}  // namespace factories
-
 class FluidSimulationFactory {
 public:
     FluidSimulationFactory(const FactoryContext& ctx) : ctx(ctx) {}
 
-    std::unique_ptr<FluidSimulationInterface> create() const {
-        return factories::PTypeFactory::create(ctx);
-    }
+    /// @brief Create simulation. All simulations are instantiated in
+    /// factory.cpp, so it's the only translation unit, that depends on
+    /// TYPES, SIZES and HOT_TYPES.
+    std::unique_ptr<FluidSimulationInterface> create() const;
+
+    /// @brief Types compiled in by TYPES.
+    static std::vector<Type> getSupportedTypes();
+    /// @brief Is combination instantiated with its own types?
+    /// Only combinations of HOT_TYPES are, if it's set, others use
+    /// GenericFluidSimulation. Otherwise all combinations of TYPES are.
+    static bool isSpecialized(const Type& pType, const Type& velocityType,
+                              const Type& velocityFlowType);
+    /// @brief Field sizes compiled in by SIZES, other sizes use dynamic
+    /// field.
+    static std::vector<std::pair<size_t, size_t>> getStaticSizes();
 
 private:
     FactoryContext ctx;
-};
\ No newline at end of file
+};
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <array>
+#include <memory>
+#include <simulation/common.hpp>
+#include <simulation/interface.hpp>
+#include <types/runtime_number.hpp>
+#include <types/type.hpp>
+
+/// @brief Simulation with types chosen at runtime.
+/// One instantiation of FluidSimulation with RuntimeNumber serves all
+/// combinations of types, so they don't need own instantiations. It's
+/// slower than instantiation with real types. RuntimeNumber repeats
+/// arithmetic of types: fields of example matched instantiations for 1000
+/// ticks for combinations of FIXED(64, 32) and FIXED(32, 16) and for
+/// combinations of DOUBLE and FLOAT. Double velocity with float flow isn't
+/// supported, flow search stalls with them.
+/// Simulation always has dynamic field and works in calling thread,
+/// because formats of RuntimeNumber are set only in it.
+class GenericFluidSimulation : public FluidSimulationInterface {
+public:
+    GenericFluidSimulation(const FluidSimulationState& state,
+                           const Type& pType, const Type& velocityType,
+                           const Type& velocityFlowType,
+                           FlowSolver flowSolver = FlowSolver::recursive);
+    ~GenericFluidSimulation() override;
+
+    bool step() override;
+    unsigned getTickCount() const override;
+    StepProfile getProfile() const override;
+    void resetProfile() override;
+    void printField(std::ostream& out = std::cout) const override;
+    void getField(DynamicMatrix<char>& field) const override;
+    FluidSimulationState getState() const override;
+    void getState(FluidSimulationState& state) const override;
+
+private:
+    class FormatScope;
+
+    // formats of p, velocity and velocity flow, then formats of their
+    // accumulators
+    std::array<NumberFormat, 6> formats;
+    std::unique_ptr<FluidSimulationInterface> simulation;
+};
@@ -0,0 +1,167 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <type_traits>
+#include <vector>
+
+constexpr size_t gridAlignment = 64;
+
+/// @brief Allocator with alignment of memory to Alignment bytes.
+template <typename T, size_t Alignment = gridAlignment>
+struct AlignedAllocator {
+    using value_type = T;
+
+    template <typename U>
+    struct rebind {
+        using other = AlignedAllocator<U, Alignment>;
+    };
+
+    constexpr AlignedAllocator() = default;
+    template <typename U>
+    constexpr AlignedAllocator(const AlignedAllocator<U, Alignment> &) {}
+
+    T *allocate(size_t n) {
+        return static_cast<T *>(
+            ::operator new(n * sizeof(T), std::align_val_t(Alignment)));
+    }
+
+    void deallocate(T *p, size_t) {
+        ::operator delete(p, std::align_val_t(Alignment));
+    }
+
+    template <typename U>
+    bool operator==(const AlignedAllocator<U, Alignment> &) const {
+        return true;
+    }
+};
+
+/// @brief Row size of grid with padding to alignment.
+template <typename T>
+constexpr size_t gridStride(size_t width) {
+    constexpr size_t rowStep = std::max<size_t>(
+        1, gridAlignment / std::min(sizeof(T), gridAlignment));
+    return (width + rowStep - 1) / rowStep * rowStep;
+}
+
+/// @brief Row count of grid (x) * padded row size (y) in one aligned buffer.
+/// Each row begins on gridAlignment boundary (if sizeof(T) divides it).
+/// If (Height, Width) == (0, 0), then size is set in runtime.
+template <typename T, size_t Height = 0, size_t Width = 0>
+class Grid {
+public:
+    static constexpr bool isDynamic = Height == 0 && Width == 0;
+
+    Grid() = default;
+
+    Grid(size_t height, size_t width) {
+        if constexpr (isDynamic) {
+            this->height = height;
+            this->width = width;
+            stride = gridStride<T>(width);
+            cells.resize(height * stride);
+        }
+    }
+
+    T *operator[](size_t x) { return cells.data() + x * getStride(); }
+    const T *operator[](size_t x) const {
+        return cells.data() + x * getStride();
+    }
+
+    T *data() { return cells.data(); }
+    const T *data() const { return cells.data(); }
+
+    size_t getHeight() const { return isDynamic ? height : Height; }
+    size_t getWidth() const { return isDynamic ? width : Width; }
+    size_t getStride() const {
+        return isDynamic ? stride : gridStride<T>(Width);
+    }
+
+    void fill(const T &value) { std::fill(cells.begin(), cells.end(), value); }
+
+private:
+    size_t height = Height, width = Width, stride = gridStride<T>(Width);
+
+    alignas(gridAlignment)
+        std::conditional_t<isDynamic, std::vector<T, AlignedAllocator<T>>,
+                           std::array<T, Height * gridStride<T>(Width)>> cells{};
+};
+
+/// @brief Separate grid for each direction of deltas.
+template <typename T, size_t Directions, size_t Height = 0, size_t Width = 0>
+struct GridPlanes {
+    std::array<Grid<T, Height, Width>, Directions> planes;
+
+    GridPlanes() = default;
+
+    GridPlanes(size_t height, size_t width) {
+        if constexpr (Grid<T, Height, Width>::isDynamic) {
+            for (auto &plane : planes) {
+                plane = Grid<T, Height, Width>(height, width);
+            }
+        }
+    }
+
+    Grid<T, Height, Width> &operator[](size_t i) { return planes[i]; }
+    const Grid<T, Height, Width> &operator[](size_t i) const {
+        return planes[i];
+    }
+
+    void fill(const T &value) {
+        for (auto &plane : planes) {
+            plane.fill(value);
+        }
+    }
+};
+
+/// @brief Grid of bits, each row is packed into 64-bit words.
+/// Bit y of row x is bit (y % 64) of word (y / 64).
+template <size_t Height = 0, size_t Width = 0>
+class BitGrid {
+public:
+    using Word = uint64_t;
+    static constexpr size_t wordBits = 64;
+
+    BitGrid() = default;
+
+    BitGrid(size_t height, size_t width)
+        : words(height, (width + wordBits - 1) / wordBits) {}
+
+    bool test(size_t x, size_t y) const {
+        return (words[x][y / wordBits] >> (y % wordBits)) & 1;
+    }
+
+    void set(size_t x, size_t y, bool value = true) {
+        Word bit = Word(1) << (y % wordBits);
+        if (value) {
+            words[x][y / wordBits] |= bit;
+        } else {
+            words[x][y / wordBits] &= ~bit;
+        }
+    }
+
+    /// @brief Words of row x.
+    const Word *operator[](size_t x) const { return words[x]; }
+
+    size_t getRowWords() const { return words.getWidth(); }
+
+    /// @brief Call fn(y) for each set bit of row x in increasing order.
+    template <typename Fn>
+    void forEach(size_t x, Fn &&fn) const {
+        const Word *row = words[x];
+        for (size_t i = 0; i < getRowWords(); ++i) {
+            for (Word word = row[i]; word != 0; word &= word - 1) {
+                fn(i * wordBits + std::countr_zero(word));
+            }
+        }
+    }
+
+    void fill(bool value) { words.fill(value ? ~Word(0) : 0); }
+
+private:
+    Grid<Word, Height, (Width + wordBits - 1) / wordBits> words;
+};
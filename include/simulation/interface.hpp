@@ -2,6 +2,7 @@
 
 #include <iostream>
 #include <simulation/common.hpp>
+#include <simulation/profile.hpp>
 
 /// @brief Simple fluid simualtion interface.
 class FluidSimulationInterface {
@@ -13,6 +14,16 @@ public:
     virtual bool step() = 0;
     /// @brief get number of steps, that somehow changes simulation field
     virtual unsigned getTickCount() const = 0;
+    /// @brief Counters of steps since last reset of profile.
+    /// They are collected only with USE_PROFILE.
+    virtual StepProfile getProfile() const = 0;
+    virtual void resetProfile() = 0;
     virtual void printField(std::ostream& out = std::cout) const = 0;
+    /// @brief Copy field into given matrix, reusing its memory,
+    /// if it has same size.
+    virtual void getField(DynamicMatrix<char>& field) const = 0;
     virtual FluidSimulationState getState() const = 0;
+    /// @brief Copy state into given state, reusing its memory,
+    /// if it has same size.
+    virtual void getState(FluidSimulationState& state) const = 0;
 };
@@ -0,0 +1,295 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+#include <types/base_fixed.hpp>
+#include <types/mixed.hpp>
+
+// AVX2 kernels are compiled with AVX2 target only, other code doesn't
+// use AVX2, so binary runs on CPUs without it.
+#if defined(USE_AVX2) && (defined(__x86_64__) || defined(__i386__))
+#define KERNELS_AVX2
+#include <immintrin.h>
+#endif
+
+/// Row kernels of simulation phases.
+/// Types with Simd<T>::lanes > 0 use AVX2, if CPU supports it, others use
+/// scalar loop, which computes in Accumulator<T>. UseSimd = false forces
+/// scalar loop, so bench can compare them.
+namespace kernels {
+
+template <typename T>
+struct Simd {
+    static constexpr size_t lanes = 0;
+};
+
+/// @brief Does CPU support AVX2 kernels?
+inline bool hasAvx2() {
+#ifdef KERNELS_AVX2
+    static const bool supported = __builtin_cpu_supports("avx2");
+    return supported;
+#else
+    return false;
+#endif
+}
+
+#ifdef KERNELS_AVX2
+
+#ifdef __clang__
+#pragma clang attribute push(__attribute__((target("avx2"))), \
+                             apply_to = function)
+#else
+#pragma GCC push_options
+#pragma GCC target("avx2")
+#endif
+
+/// @brief Lanes of 64-bit integers (raw values of BaseFixed).
+template <typename T>
+struct SimdInt64 {
+    using Vec = __m256i;
+    static constexpr size_t lanes = 4;
+
+    static Vec load(const T *p) {
+        return _mm256_loadu_si256(reinterpret_cast<const Vec *>(p));
+    }
+    static void store(T *p, Vec v) {
+        _mm256_storeu_si256(reinterpret_cast<Vec *>(p), v);
+    }
+    static Vec broadcast(T x) { return _mm256_set1_epi64x(x.v); }
+    static Vec add(Vec a, Vec b) { return _mm256_add_epi64(a, b); }
+    static Vec sub(Vec a, Vec b) { return _mm256_sub_epi64(a, b); }
+    static Vec greaterZero(Vec a) {
+        return _mm256_cmpgt_epi64(a, _mm256_setzero_si256());
+    }
+    static Vec select(Vec mask, Vec a, Vec b) {
+        return _mm256_blendv_epi8(b, a, mask);
+    }
+    static Vec maskZero(Vec mask, Vec a) { return _mm256_and_si256(mask, a); }
+    /// @brief Mask of lanes, which bits are set in low bits of mask.
+    static Vec fromBits(uint64_t bits) {
+        const Vec laneBits = _mm256_setr_epi64x(1, 2, 4, 8);
+        return _mm256_cmpeq_epi64(
+            _mm256_and_si256(_mm256_set1_epi64x(bits), laneBits), laneBits);
+    }
+};
+
+/// @brief Lanes of 32-bit integers (raw values of BaseFixed).
+template <typename T>
+struct SimdInt32 {
+    using Vec = __m256i;
+    static constexpr size_t lanes = 8;
+
+    static Vec load(const T *p) {
+        return _mm256_loadu_si256(reinterpret_cast<const Vec *>(p));
+    }
+    static void store(T *p, Vec v) {
+        _mm256_storeu_si256(reinterpret_cast<Vec *>(p), v);
+    }
+    static Vec broadcast(T x) { return _mm256_set1_epi32(x.v); }
+    static Vec add(Vec a, Vec b) { return _mm256_add_epi32(a, b); }
+    static Vec sub(Vec a, Vec b) { return _mm256_sub_epi32(a, b); }
+    static Vec greaterZero(Vec a) {
+        return _mm256_cmpgt_epi32(a, _mm256_setzero_si256());
+    }
+    static Vec select(Vec mask, Vec a, Vec b) {
+        return _mm256_blendv_epi8(b, a, mask);
+    }
+    static Vec maskZero(Vec mask, Vec a) { return _mm256_and_si256(mask, a); }
+    /// @brief Mask of lanes, which bits are set in low bits of mask.
+    static Vec fromBits(uint64_t bits) {
+        const Vec laneBits = _mm256_setr_epi32(1, 2, 4, 8, 16, 32, 64, 128);
+        return _mm256_cmpeq_epi32(
+            _mm256_and_si256(_mm256_set1_epi32(int32_t(bits)), laneBits),
+            laneBits);
+    }
+};
+
+/// @brief Lanes of 16-bit integers (raw values of BaseFixed), add and sub
+/// saturate for saturating BaseFixed.
+template <typename T>
+struct SimdInt16 {
+    using Vec = __m256i;
+    static constexpr size_t lanes = 16;
+
+    static Vec load(const T *p) {
+        return _mm256_loadu_si256(reinterpret_cast<const Vec *>(p));
+    }
+    static void store(T *p, Vec v) {
+        _mm256_storeu_si256(reinterpret_cast<Vec *>(p), v);
+    }
+    static Vec broadcast(T x) { return _mm256_set1_epi16(x.v); }
+    static Vec add(Vec a, Vec b) {
+        if constexpr (T::Saturating) {
+            return _mm256_adds_epi16(a, b);
+        }
+        return _mm256_add_epi16(a, b);
+    }
+    static Vec sub(Vec a, Vec b) {
+        if constexpr (T::Saturating) {
+            return _mm256_subs_epi16(a, b);
+        }
+        return _mm256_sub_epi16(a, b);
+    }
+    static Vec greaterZero(Vec a) {
+        return _mm256_cmpgt_epi16(a, _mm256_setzero_si256());
+    }
+    static Vec select(Vec mask, Vec a, Vec b) {
+        return _mm256_blendv_epi8(b, a, mask);
+    }
+    static Vec maskZero(Vec mask, Vec a) { return _mm256_and_si256(mask, a); }
+    /// @brief Mask of lanes, which bits are set in low bits of mask.
+    static Vec fromBits(uint64_t bits) {
+        const Vec laneBits = _mm256_setr_epi16(
+            1, 2, 4, 8, 16, 32, 64, 128, 256, 512, 1024, 2048, 4096, 8192,
+            16384, -32768);
+        return _mm256_cmpeq_epi16(
+            _mm256_and_si256(_mm256_set1_epi16(int16_t(bits)), laneBits),
+            laneBits);
+    }
+};
+
+template <>
+struct Simd<double> {
+    using Vec = __m256d;
+    static constexpr size_t lanes = 4;
+
+    static Vec load(const double *p) { return _mm256_loadu_pd(p); }
+    static void store(double *p, Vec v) { _mm256_storeu_pd(p, v); }
+    static Vec broadcast(double x) { return _mm256_set1_pd(x); }
+    static Vec add(Vec a, Vec b) { return _mm256_add_pd(a, b); }
+    static Vec sub(Vec a, Vec b) { return _mm256_sub_pd(a, b); }
+    static Vec greaterZero(Vec a) {
+        return _mm256_cmp_pd(a, _mm256_setzero_pd(), _CMP_GT_OQ);
+    }
+    static Vec select(Vec mask, Vec a, Vec b) {
+        return _mm256_blendv_pd(b, a, mask);
+    }
+    static Vec maskZero(Vec mask, Vec a) { return _mm256_and_pd(mask, a); }
+    static Vec fromBits(uint64_t bits) {
+        return _mm256_castsi256_pd(SimdInt64<int64_t>::fromBits(bits));
+    }
+};
+
+template <>
+struct Simd<float> {
+    using Vec = __m256;
+    static constexpr size_t lanes = 8;
+
+    static Vec load(const float *p) { return _mm256_loadu_ps(p); }
+    static void store(float *p, Vec v) { _mm256_storeu_ps(p, v); }
+    static Vec broadcast(float x) { return _mm256_set1_ps(x); }
+    static Vec add(Vec a, Vec b) { return _mm256_add_ps(a, b); }
+    static Vec sub(Vec a, Vec b) { return _mm256_sub_ps(a, b); }
+    static Vec greaterZero(Vec a) {
+        return _mm256_cmp_ps(a, _mm256_setzero_ps(), _CMP_GT_OQ);
+    }
+    static Vec select(Vec mask, Vec a, Vec b) {
+        return _mm256_blendv_ps(b, a, mask);
+    }
+    static Vec maskZero(Vec mask, Vec a) { return _mm256_and_ps(mask, a); }
+    static Vec fromBits(uint64_t bits) {
+        return _mm256_castsi256_ps(SimdInt32<int32_t>::fromBits(bits));
+    }
+};
+
+template <typename St, size_t K>
+    requires(std::is_integral_v<St> && sizeof(St) == 8)
+struct Simd<BaseFixed<St, K>> : SimdInt64<BaseFixed<St, K>> {};
+
+template <typename St, size_t K>
+    requires(std::is_integral_v<St> && sizeof(St) == 4)
+struct Simd<BaseFixed<St, K>> : SimdInt32<BaseFixed<St, K>> {};
+
+template <typename St, size_t K, bool Saturating>
+    requires(std::is_integral_v<St> && sizeof(St) == 2)
+struct Simd<BaseFixed<St, K, Saturating>>
+    : SimdInt16<BaseFixed<St, K, Saturating>> {};
+
+/// @brief AVX2 part of addIfOpen.
+/// @return number of processed cells.
+template <typename T>
+size_t addIfOpenSimd(T *values, const uint64_t *open, size_t width,
+                     Accumulator<T> value) {
+    using S = Simd<T>;
+    size_t y = 0;
+    auto add = S::broadcast(value);
+    // Lanes divide 64, so chunk of lanes is inside one word.
+    for (; y + S::lanes <= width; y += S::lanes) {
+        auto mask = S::fromBits(open[y / 64] >> (y % 64));
+        auto v = S::load(values + y);
+        S::store(values + y, S::select(mask, S::add(v, add), v));
+    }
+    return y;
+}
+
+/// @brief AVX2 part of takeFlow.
+/// @return number of processed cells.
+template <typename T>
+size_t takeFlowSimd(T *velocity, const T *flow, Accumulator<T> *delta,
+                    size_t width) {
+    using S = Simd<T>;
+    size_t y = 0;
+    for (; y + S::lanes <= width; y += S::lanes) {
+        auto v = S::load(velocity + y);
+        auto f = S::load(flow + y);
+        auto positive = S::greaterZero(v);
+        S::store(delta + y, S::maskZero(positive, S::sub(v, f)));
+        S::store(velocity + y, S::select(positive, f, v));
+    }
+    return y;
+}
+
+#ifdef __clang__
+#pragma clang attribute pop
+#else
+#pragma GCC pop_options
+#endif
+
+#endif
+
+/// @brief Add value to cells of row, which bits are set in open.
+/// Bit y is bit (y % 64) of open[y / 64].
+template <typename T, bool UseSimd = true>
+void addIfOpen(T *values, const uint64_t *open, size_t width,
+               Accumulator<T> value) {
+    size_t y = 0;
+#ifdef KERNELS_AVX2
+    if constexpr (UseSimd && Simd<T>::lanes > 0) {
+        if (hasAvx2()) {
+            y = addIfOpenSimd(values, open, width, value);
+        }
+    }
+#endif
+    for (; y < width; ++y) {
+        if ((open[y / 64] >> (y % 64)) & 1) {
+            values[y] = Accumulator<T>(values[y]) + value;
+        }
+    }
+}
+
+/// @brief Replace positive velocities of row with flows.
+/// delta[y] = velocity[y] - flow[y] for replaced cells, 0 for others.
+template <typename T, bool UseSimd = true>
+void takeFlow(T *velocity, const T *flow, Accumulator<T> *delta,
+              size_t width) {
+    size_t y = 0;
+#ifdef KERNELS_AVX2
+    if constexpr (UseSimd && Simd<T>::lanes > 0) {
+        if (hasAvx2()) {
+            y = takeFlowSimd(velocity, flow, delta, width);
+        }
+    }
+#endif
+    using A = Accumulator<T>;
+    for (; y < width; ++y) {
+        if (A(velocity[y]) > 0) {
+            delta[y] = A(velocity[y]) - A(flow[y]);
+            velocity[y] = flow[y];
+        } else {
+            delta[y] = A(0);
+        }
+    }
+}
+
+}  // namespace kernels
@@ -0,0 +1,127 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Profiling is compiled in only with USE_PROFILE, otherwise all calls of
+// StepProfiler are empty.
+#ifdef USE_PROFILE
+constexpr bool profileEnabled = true;
+#else
+constexpr bool profileEnabled = false;
+#endif
+
+/// @brief Phases of simulation step in order of execution.
+enum class Phase {
+    // external forces
+    gravity,
+    // forces from p
+    pressure,
+    // propagateFlow loop
+    flow,
+    // recalculation of p with kinetic energy
+    kinetic,
+    // propagateMove and propagateStop
+    move,
+};
+
+constexpr size_t phaseCount = 5;
+
+const char* to_string(Phase phase);
+
+/// @brief Counters of flow search, kept by each flow region separately,
+/// so regions can be searched concurrently.
+struct FlowCounters {
+    // rounds of flow search loop
+    uint64_t rounds = 0;
+    // calls of propagateFlow
+    uint64_t calls = 0;
+    // max depth of propagateFlow recursion
+    uint64_t maxDepth = 0;
+
+    void addCall(uint64_t depth) {
+        calls++;
+        maxDepth = std::max(maxDepth, depth);
+    }
+
+    void add(const FlowCounters& other);
+};
+
+/// @brief Counters of simulation steps since last reset.
+struct StepProfile {
+    std::array<std::chrono::nanoseconds, phaseCount> phaseTime{};
+    // steps, that changed field
+    uint64_t ticks = 0;
+    // all steps
+    uint64_t steps = 0;
+    FlowCounters flow;
+    // cells, that were moved by propagateMove
+    uint64_t cellsMoved = 0;
+    // parallel phases and time, that stepping thread waited for pool
+    // threads at their ends
+    uint64_t syncPhases = 0;
+    std::chrono::nanoseconds syncWaitTime{0};
+
+    std::chrono::nanoseconds getTotalTime() const;
+    void add(const StepProfile& other);
+};
+
+/// @brief Human readable summary of profile.
+std::string formatProfile(const StepProfile& profile);
+
+/// @brief Collects StepProfile of one simulation. Time of phase lasts
+/// until start of next phase or end of step.
+class StepProfiler {
+public:
+    void startPhase(Phase phase) {
+        if constexpr (profileEnabled) {
+            auto now = std::chrono::steady_clock::now();
+            finishPhase(now);
+            current = phase;
+            phaseStart = now;
+            isRunning = true;
+        }
+    }
+
+    void endStep(bool changed) {
+        if constexpr (profileEnabled) {
+            finishPhase(std::chrono::steady_clock::now());
+            profile.steps++;
+            profile.ticks += changed;
+        }
+    }
+
+    void addFlow(FlowCounters& counters) {
+        if constexpr (profileEnabled) {
+            profile.flow.add(counters);
+            counters = FlowCounters();
+        }
+    }
+
+    void addMovedCell() {
+        if constexpr (profileEnabled) {
+            profile.cellsMoved++;
+        }
+    }
+
+    const StepProfile& get() const { return profile; }
+
+    void reset() { profile = StepProfile(); }
+
+private:
+    StepProfile profile;
+    Phase current = Phase::gravity;
+    std::chrono::steady_clock::time_point phaseStart;
+    bool isRunning = false;
+
+    void finishPhase(std::chrono::steady_clock::time_point now) {
+        if (isRunning) {
+            profile.phaseTime[size_t(current)] += now - phaseStart;
+            isRunning = false;
+        }
+    }
+};
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <cstdint>
+
+/// @brief Counter-based random generator. Each value is a hash of seed and
+/// counter, so it doesn't depend on order, in which values are taken, and
+/// generator has no state to share between threads.
+class CounterRandom {
+public:
+    explicit constexpr CounterRandom(uint64_t seed) : seed(seed) {}
+
+    /// @brief Random 64 bits for draw of cell (x, y) at step.
+    constexpr uint64_t operator()(uint64_t step, uint32_t x, uint32_t y,
+                                  uint32_t draw) const {
+        uint64_t h = mix(seed ^ mix(step));
+        h = mix(h ^ ((uint64_t(x) << 32) | y));
+        return mix(h ^ draw);
+    }
+
+    constexpr uint64_t getSeed() const { return seed; }
+
+private:
+    uint64_t seed;
+
+    /// @brief Step of SplitMix64.
+    static constexpr uint64_t mix(uint64_t x) {
+        x += 0x9e3779b97f4a7c15ull;
+        x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ull;
+        x = (x ^ (x >> 27)) * 0x94d049bb133111ebull;
+        return x ^ (x >> 31);
+    }
+};
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <simulation/common.hpp>
+#include <simulation/save_load.hpp>
+#include <string>
+#include <vector>
+
+/// @brief Replay of saves of one dir.
+/// Saves are indexed once. Full saves are mapped to memory and delta saves
+/// are applied to current state, so moving forward doesn't load whole
+/// chain of deltas again.
+class SaveReplay {
+public:
+    struct Entry {
+        unsigned tickCount;
+        SaveInfo info;
+    };
+
+    /// @brief Index saves of dir (files with tick count as name).
+    explicit SaveReplay(const std::string& dir);
+
+    const std::vector<Entry>& getEntries() const { return entries; }
+
+    /// @brief Move to save with greatest tick count <= tickCount,
+    /// or to first save, if there is no such save.
+    const FluidSimulationState& seek(unsigned tickCount);
+    /// @brief Move to next save.
+    /// @return false, if current save is last.
+    bool next();
+
+    const FluidSimulationState& getState() const { return state; }
+    unsigned getTickCount() const { return state.tickCount; }
+
+private:
+    std::string dir;
+    std::vector<Entry> entries;
+    // index of loaded entry, entries.size() if nothing is loaded
+    size_t current;
+    FluidSimulationState state;
+
+    void moveTo(size_t index);
+    /// @brief Is entry delta save from previous entry?
+    bool isChained(size_t index) const;
+    std::string getPath(size_t index) const;
+};
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <simulation/common.hpp>
+#include <simulation/profile.hpp>
+#include <string>
+#include <thread/thread_pool.hpp>
+#include <types/type.hpp>
+#include <vector>
+
+/// @brief Independent simulation run by SimulationRunner.
+struct SimulationJob {
+    // file with simulation start state description
+    std::string inputFile;
+    Type pType, velocityType, velocityFlowType;
+    unsigned ticks = 0;
+};
+
+struct SimulationJobResult {
+    // ticks and steps made by job
+    unsigned ticks = 0;
+    uint64_t steps = 0;
+    // job was stopped by step limit before its ticks
+    bool truncated = false;
+    double seconds = 0;
+    StepProfile profile;
+    // message of error, if job failed
+    std::string error;
+};
+
+/// @brief Runs many simulations concurrently on one pool of threads.
+/// Each job is run by one thread from start to end, so jobs don't need
+/// own threads and all threads are busy, while there are jobs left.
+/// Threads take jobs in order of list.
+class SimulationRunner {
+public:
+    /// @brief Called after each job, calls are serialized.
+    using ResultCallback =
+        std::function<void(size_t index, const SimulationJobResult& result)>;
+
+    /// @param maxSteps Max steps of each job, 0 for no limit.
+    SimulationRunner(unsigned threads, FlowSolver flowSolver,
+                     uint64_t maxSteps = 0);
+
+    std::vector<SimulationJobResult> run(
+        const std::vector<SimulationJob>& jobs,
+        const ResultCallback& onResult = nullptr);
+
+private:
+    // Calling thread runs jobs too.
+    ThreadPool pool;
+    FlowSolver flowSolver;
+    uint64_t maxSteps;
+    std::mutex mutex;
+
+    SimulationJobResult runJob(const SimulationJob& job) const;
+};
@@ -1,15 +1,114 @@
 #pragma once
 
+#include <cstdint>
 #include <iostream>
 #include <simulation/common.hpp>
+#include <string>
+
+/// @brief Header of bin save.
+/// Header is followed by planes of state, each plane starts at
+/// planeOffsets[i] (multiple of saveAlignment), so planes can be used
+/// directly from mapped file.
+/// Header of version 2 ends before seed, such saves are loaded with
+/// defaultSeed.
+struct SaveHeader {
+    static constexpr char signature[8] = {'F', 'L', 'U', 'I',
+                                          'D', 'S', 'A', 'V'};
+    static constexpr uint32_t currentVersion = 3;
+    // Written in byte order of machine, that saved file.
+    static constexpr uint32_t byteOrderTag = 0x01020304;
+    // field, p, dirs, lastUse, velocity for each direction
+    static constexpr size_t planeCount = 4 + deltas.size();
+
+    char magic[8];
+    uint32_t version;
+    uint32_t byteOrder;
+    uint64_t height, width;
+    uint32_t tickCount;
+    int32_t UT;
+    int64_t g;
+    int64_t rho[rhoSize];
+    uint64_t planeOffsets[planeCount];
+    uint64_t seed;
+};
+
+constexpr size_t saveAlignment = 64;
+
+/// @brief Header of delta save.
+/// Delta save keeps difference of planes from previous save (base) of
+/// same dir, so it's loaded by applying difference to loaded base.
+/// Header is followed by encoded difference of each plane, difference is
+/// bytes of plane xor bytes of base plane (stamps of lastUse equal to base
+/// UT are replaced by UT first), encoded as sequence of
+/// (count of zero bytes, count of next bytes, next bytes) with varint
+/// counts. Seed of delta save is seed of its base.
+struct DeltaSaveHeader {
+    static constexpr char signature[8] = {'F', 'L', 'U', 'I',
+                                          'D', 'D', 'L', 'T'};
+    static constexpr uint32_t currentVersion = 1;
+
+    char magic[8];
+    uint32_t version;
+    uint32_t byteOrder;
+    uint64_t height, width;
+    uint32_t tickCount;
+    int32_t UT;
+    // tick count of base save
+    uint32_t baseTickCount;
+    uint32_t reserved;
+    // size of encoded difference of each plane
+    uint64_t planeSizes[SaveHeader::planeCount];
+};
 
 /// @brief Load start state of fluid simulation from text file.
 /// @return State of fluid simulation.
 FluidSimulationState loadFluidSimulationStartState(std::istream& in);
 
-/// @brief Load any state of fluid simulation from bin file.
+/// @brief Load any state of fluid simulation from bin stream.
+/// Saves without header (version 1) are also supported.
 FluidSimulationState loadFluidSimulationState(std::istream& in);
 
+/// @brief Load any state of fluid simulation from bin file.
+/// File of current version is mapped to memory and planes of state point
+/// to mapped file, so cells aren't copied while loading.
+/// For delta save all saves of chain are loaded from dir of file.
+FluidSimulationState loadFluidSimulationState(const std::string& path);
+
 /// @brief Save any state of fluid simulation to bin file.
 void saveFluidSimulationState(std::ostream& out,
                               const FluidSimulationState& state);
+
+/// @brief Save difference of state from base state.
+/// Base must have same size and must be saved as tick base.tickCount
+/// in the same dir.
+void saveFluidSimulationStateDelta(std::ostream& out,
+                                   const FluidSimulationState& state,
+                                   const FluidSimulationState& base);
+
+/// @brief Kind of bin save.
+struct SaveInfo {
+    bool isDelta = false;
+    // tick count of base save, if it's delta save
+    unsigned baseTickCount = 0;
+};
+
+SaveInfo getSaveInfo(const std::string& path);
+
+/// @brief Apply delta save to state, which must be state of its base save.
+void applyDeltaSave(FluidSimulationState& state, const std::string& path);
+
+/// @brief Saves states in chain: every fullSaveRate-th save is full,
+/// other saves are deltas from previous save.
+class SaveChain {
+public:
+    explicit SaveChain(unsigned fullSaveRate = 1)
+        : fullSaveRate(fullSaveRate) {}
+
+    void save(std::ostream& out, const FluidSimulationState& state);
+
+private:
+    unsigned fullSaveRate;
+    unsigned saves = 0;
+    // last saved state
+    FluidSimulationState previous;
+};
@@ -4,18 +4,24 @@
 #include <array>
 #include <cassert>
 #include <queue>
-#include <random>
 #include <ranges>
 #include <simulation/common.hpp>
+#include <simulation/grid.hpp>
 #include <simulation/interface.hpp>
+#include <simulation/kernels.hpp>
+#include <simulation/profile.hpp>
+#include <simulation/random.hpp>
 #include <thread/thread_pool.hpp>
 #include <type_traits>
 #include <types/fixed.hpp>
+#include <types/mixed.hpp>
 #include <vector>
 
 /// @brief Base fluid simulation.
 /// If (Height, Width) == (0, 0), then use dynamic field.
 /// Otherwise use static field.
+/// Values are stored as given types, but arithmetic with them is done in
+/// their accumulators (see Mixed).
 template <typename PType, typename VelocityType, typename VelocityFlowType,
           size_t Height = 0, size_t Width = 0>
 class FluidSimulation : virtual public FluidSimulationInterface {
@@ -23,233 +29,270 @@ protected:
     static constexpr bool isDynamic = Height == 0 && Width == 0;
 
     template <typename T>
-    using Matrix = std::conditional<isDynamic, DynamicMatrix<T>,
-                                    StaticMatrix<T, Height, Width>>::type;
+    using Matrix = Grid<T, Height, Width>;
 
     template <typename T>
-    using VectorMatrix =
-        std::conditional<isDynamic, DynamicVectorMatrix<T>,
-                         StaticVectorMatrix<T, Height, Width>>::type;
+    using VectorMatrix = GridPlanes<T, deltas.size(), Height, Width>;
+
+    using PAccumulator = Accumulator<PType>;
+    using VelocityAccumulator = Accumulator<VelocityType>;
+    using VelocityFlowAccumulator = Accumulator<VelocityFlowType>;
 
 public:
-    FluidSimulation(const FluidSimulationState &state, unsigned threads = 1)
+    FluidSimulation(const FluidSimulationState &state, unsigned threads = 1,
+                    FlowSolver flowSolver = FlowSolver::recursive)
         : height(state.getFieldHeight()),
           width(state.getFieldWidth()),
           g(state.g),
           rho(state.rho),
           UT(state.UT),
           tickCount(state.tickCount),
-          pool(threads) {
-        // Allocate memory if simulation is dynamic.
-        if constexpr (isDynamic) {
-            this->field.resize(this->height, std::vector<char>(this->width));
-            this->p.resize(this->height, std::vector<PType>(this->width));
-            this->dirs.resize(this->height, std::vector<int>(this->width, 0));
-            this->lastUse.resize(this->height,
-                                 std::vector<int>(this->width, 0));
-            this->velocity.v.resize(
-                this->height,
-                std::vector<std::array<VelocityType, deltas.size()>>(
-                    this->width, std::array<VelocityType, deltas.size()>()));
-            this->velocityFlow.v.resize(
-                this->height,
-                std::vector<std::array<VelocityFlowType, deltas.size()>>(
-                    this->width,
-                    std::array<VelocityFlowType, deltas.size()>()));
-            this->old_p = this->p;
-        }
-
+          rng(state.seed),
+          pool(std::max(threads, 1u) - 1),
+          flowSolver(flowSolver) {
         // Copy state.
         for (size_t x = 0; x < this->height; ++x) {
+            std::copy_n(state.field[x], width, this->field[x]);
+            std::copy_n(state.dirs[x], width, this->dirs[x]);
+            std::copy_n(state.lastUse[x], width, this->lastUse[x]);
             for (size_t y = 0; y < this->width; ++y) {
-                this->field[x][y] = state.field[x][y];
-                this->p[x][y] = PType(state.p[x][y]);
-                this->dirs[x][y] = state.dirs[x][y];
-                this->lastUse[x][y] = state.lastUse[x][y];
-
-                for (size_t k = 0; k < deltas.size(); k++) {
-                    this->velocity.v[x][y][k] =
-                        VelocityType(state.velocity[x][y][k]);
+                this->p[x][y] = PAccumulator(state.p[x][y]);
+            }
+            for (size_t k = 0; k < deltas.size(); k++) {
+                for (size_t y = 0; y < this->width; ++y) {
+                    this->velocity.v[k][x][y] =
+                        VelocityAccumulator(state.velocity[k][x][y]);
                 }
             }
         }
+
+        findOpenCells();
     }
 
+    /// @brief Make one step. Only flow search is limited to active cells:
+    /// gravity changes velocity of every open cell each tick, so other
+    /// phases have no settled cells, that could be skipped without
+    /// changing results.
     bool step() override {
-        PType total_delta_p = 0;
+        // Keep pool threads awake between phases of tick.
+        ThreadPool::PhaseScope phases(pool);
 
-        // Apply external forces
+        profiler.startPhase(Phase::gravity);
+        // Apply external forces.
+        // Last row is a wall, so it's skipped.
         auto computeRow = [this](size_t x) {
-            for (size_t y = 0; y < this->width; ++y) {
-                if (this->field[x][y] == '#') continue;
-                if (this->field[x + 1][y] != '#')
-                    this->velocity.add(x, y, 1, 0, VelocityType(this->g));
-            }
+            constexpr size_t down = getDeltaIndex(1, 0);
+            kernels::addIfOpen(this->velocity.v[down][x],
+                               this->openTo[down][x], this->width,
+                               VelocityAccumulator(this->g));
         };
-        for (size_t x = 0; x < height; x++) {
-            pool.addTask(computeRow, x);
-        }
-        pool.waitAll();
+        pool.parallelFor(0, std::max<size_t>(height, 1) - 1, rowGrain,
+                         computeRow);
 
-        for (size_t x = 0; x < height; ++x) {
-            for (size_t y = 0; y < width; ++y) {
-                old_p[x][y] = p[x][y];
+        profiler.startPhase(Phase::pressure);
+        auto copyRow = [this](size_t x) {
+            for (size_t y = 0; y < this->width; ++y) {
+                this->old_p[x][y] = this->p[x][y];
             }
-        }
-
-        // Apply forces from p
-        for (size_t x = 0; x < height; ++x) {
-            for (size_t y = 0; y < width; ++y) {
-                if (field[x][y] == '#') continue;
-                for (auto [dx, dy] : deltas) {
+        };
+        pool.parallelFor(0, height, rowGrain, copyRow);
+
+        // Apply forces from p.
+        // Edge between two cells is changed only by the cell with greater
+        // old_p, so rows can be processed independently.
+        auto applyForcesRow = [this](size_t x) {
+            this->open.forEach(x, [this, x](size_t y) {
+                for (size_t k = 0; k < deltas.size(); ++k) {
+                    auto [dx, dy] = deltas[k];
                     int nx = x + dx, ny = y + dy;
-                    if (field[nx][ny] != '#' && old_p[nx][ny] < old_p[x][y]) {
-                        PType force = old_p[x][y] - old_p[nx][ny];
-                        VelocityType &contr = velocity.get(nx, ny, -dx, -dy);
-                        if (contr * VelocityType(rho[(int)field[nx][ny]]) >=
-                            force) {
-                            contr -= VelocityType(
-                                force / PType(rho[(int)field[nx][ny]]));
+                    if (!this->openTo[k].test(x, y)) {
+                        continue;
+                    }
+                    auto oldP = PAccumulator(this->old_p[x][y]);
+                    auto nOldP = PAccumulator(this->old_p[nx][ny]);
+                    if (nOldP < oldP) {
+                        PAccumulator force = oldP - nOldP;
+                        VelocityType &contr =
+                            this->velocity.get(nx, ny, -dx, -dy);
+                        auto contrValue = VelocityAccumulator(contr);
+                        Fixed<> nRho = this->rho[(int)this->field[nx][ny]];
+                        if (contrValue * VelocityAccumulator(nRho) >= force) {
+                            contr = contrValue -
+                                    VelocityAccumulator(force /
+                                                        PAccumulator(nRho));
                             continue;
                         }
-                        force -= PType(contr *
-                                       VelocityType(rho[(int)field[nx][ny]]));
-                        contr = 0;
-                        velocity.add(
+                        force -= PAccumulator(contrValue *
+                                              VelocityAccumulator(nRho));
+                        contr = VelocityAccumulator(0);
+                        Fixed<> cellRho = this->rho[(int)this->field[x][y]];
+                        this->velocity.add(
                             x, y, dx, dy,
-                            VelocityType(force / PType(rho[(int)field[x][y]])));
-                        p[x][y] -= force / dirs[x][y];
-                        total_delta_p -= force / dirs[x][y];
+                            VelocityAccumulator(force / PAccumulator(cellRho)));
+                        this->p[x][y] = PAccumulator(this->p[x][y]) -
+                                        force / this->dirs[x][y];
                     }
                 }
-            }
-        }
+            });
+        };
+        pool.parallelFor(0, height, rowGrain, applyForcesRow);
 
+        profiler.startPhase(Phase::flow);
         // Make flow from velocities
         velocityFlow.reset();
-        bool any_prop;
-        std::vector<std::pair<size_t, size_t>> current;
-        std::vector<std::pair<size_t, size_t>> next;
-        current.reserve(height * width);
-        next.reserve(height * width);
+        if (flowSolver == FlowSolver::parallel) {
+            // Find flows inside bands concurrently, then finish serially
+            // with flows crossing bands.
+            // Flows inside bands are found before flows crossing them, so
+            // found flows and fields differ from recursive solver, when
+            // field has several bands. Bands don't depend on threads, so
+            // fields are same for any number of threads.
+            auto makeBandFlow = [this](size_t i) {
+                this->flowBands[i].ut = this->UT;
+                this->makeFlow(this->flowBands[i]);
+            };
+            pool.parallelFor(0, flowBands.size(), 1, makeBandFlow);
 
-        for (size_t x = 0; x < height; ++x) {
-            for (size_t y = 0; y < width; ++y) {
-                if (field[x][y] != '#') {
-                    current.push_back({x, y});
-                }
+            for (auto &band : flowBands) {
+                UT = std::max(UT, band.ut);
+                profiler.addFlow(band.counters);
             }
         }
-
-        do {
-            UT += 2;
-            any_prop = false;
-
-            for (auto [x, y] : current) {
-                if (lastUse[x][y] != UT) {
-                    auto [t, local_prop, _] = propagateFlow(x, y, 1);
-                    if (t > 0) {
-                        next.push_back({x, y});
-                        for (auto [dx, dy] : deltas) {
-                            int nx = x + dx, ny = y + dy;
-                            if (field[nx][ny] != '#') {
-                                next.push_back({nx, ny});
-                            }
-                        }
-                        any_prop = true;
+        flowField.ut = UT;
+        makeFlow(flowField);
+        UT = flowField.ut;
+        profiler.addFlow(flowField.counters);
+
+        profiler.startPhase(Phase::kinetic);
+        // Recalculate p with kinetic energy.
+        // Deltas of all directions of row are taken first, then cells add
+        // them to p in order of previous scalar loop (cell, then direction),
+        // so floating sums don't change.
+        for (size_t x = 0; x < height; ++x) {
+            for (size_t k = 0; k < deltas.size(); ++k) {
+                const VelocityType *flow;
+                if constexpr (std::is_same_v<VelocityType, VelocityFlowType>) {
+                    flow = velocityFlow.v[k][x];
+                } else {
+                    for (size_t y = 0; y < width; ++y) {
+                        kineticFlow[y] = VelocityAccumulator(
+                            VelocityFlowAccumulator(velocityFlow.v[k][x][y]));
                     }
-                } else if (flowCache[x][y] > 0) {
-                    next.push_back({x, y});
+                    flow = kineticFlow.data();
                 }
+                kernels::takeFlow(velocity.v[k][x], flow,
+                                  kineticDelta[k].data(), width);
             }
 
-            swap(current, next);
-            next.clear();
-        } while (any_prop);
-
-        // Recalculate p with kinetic energy
-        for (size_t x = 0; x < height; ++x) {
-            for (size_t y = 0; y < width; ++y) {
-                if (field[x][y] == '#') continue;
-                for (auto [dx, dy] : deltas) {
-                    VelocityType old_v = velocity.get(x, y, dx, dy);
-                    VelocityType new_v =
-                        VelocityType(velocityFlow.get(x, y, dx, dy));
-                    if (old_v > 0) {
-                        assert(new_v <= old_v);
-                        velocity.get(x, y, dx, dy) = new_v;
-                        PType force = (old_v - new_v) *
-                                      VelocityType(rho[(int)field[x][y]]);
-                        if (field[x][y] == '.') {
-                            force *= 0.8;
-                        }
-                        if (field[x + dx][y + dy] == '#') {
-                            p[x][y] += force / dirs[x][y];
-                            total_delta_p += force / dirs[x][y];
-                        } else {
-                            p[x + dx][y + dy] += force / dirs[x + dx][y + dy];
-                            total_delta_p += force / dirs[x + dx][y + dy];
-                        }
+            open.forEach(x, [&, x](size_t y) {
+                for (size_t k = 0; k < deltas.size(); ++k) {
+                    if (kineticDelta[k][y] == 0) continue;
+                    assert(kineticDelta[k][y] > 0);
+                    auto [dx, dy] = deltas[k];
+                    PAccumulator force =
+                        kineticDelta[k][y] *
+                        VelocityAccumulator(rho[(int)field[x][y]]);
+                    if (field[x][y] == '.') {
+                        force *= 0.8;
                     }
+                    int tx = x, ty = y;
+                    if (openTo[k].test(x, y)) {
+                        tx += dx;
+                        ty += dy;
+                    }
+                    p[tx][ty] = PAccumulator(p[tx][ty]) + force / dirs[tx][ty];
                 }
-            }
+            });
         }
 
+        profiler.startPhase(Phase::move);
         UT += 2;
         bool prop = false;
-        for (size_t x = 0; x < height; ++x) {
-            for (size_t y = 0; y < width; ++y) {
-                if (field[x][y] != '#' && lastUse[x][y] != UT) {
-                    if (random01() < moveProb(x, y)) {
-                        prop = true;
-                        propagateMove(x, y, true);
-                    } else {
-                        propagateStop(x, y, true);
-                    }
+        for (auto [x, y] : openCells) {
+            if (lastUse[x][y] != UT) {
+                if (random01(x, y, 0) < moveProb(x, y)) {
+                    prop = true;
+                    propagateMove(x, y, true);
+                } else {
+                    propagateStop(x, y, true);
                 }
             }
         }
 
         if (prop) {
             tickCount++;
+            tickSteps = 0;
+        } else {
+            tickSteps++;
         }
 
+        profiler.endStep(prop);
         return prop;
     }
 
     void printField(std::ostream &out) const override {
         for (size_t x = 0; x < height; ++x) {
-            for (size_t y = 0; y < width; ++y) {
-                out << field[x][y];
-            }
+            out.write(field[x], width);
             out << '\n';
         }
         out << std::flush;
     }
 
+    void getField(DynamicMatrix<char> &field) const override {
+        if (field.getHeight() != height || field.getWidth() != width) {
+            field = DynamicMatrix<char>(height, width);
+        }
+        for (size_t x = 0; x < height; ++x) {
+            std::copy_n(this->field[x], width, field[x]);
+        }
+    }
+
     unsigned getTickCount() const override { return tickCount; }
 
-    virtual FluidSimulationState getState() const override {
+    StepProfile getProfile() const override {
+        StepProfile profile = profiler.get();
+        auto sync = pool.getSyncStats();
+        profile.syncPhases = sync.phases;
+        profile.syncWaitTime = sync.waitTime;
+        return profile;
+    }
+
+    void resetProfile() override {
+        profiler.reset();
+        pool.resetSyncStats();
+    }
+
+    FluidSimulationState getState() const override {
         FluidSimulationState state(this->height, this->width);
+        getState(state);
+        return state;
+    }
+
+    void getState(FluidSimulationState &state) const override {
+        if (state.getFieldHeight() != this->height ||
+            state.getFieldWidth() != this->width) {
+            state = FluidSimulationState(this->height, this->width);
+        }
         state.g = this->g;
         state.rho = this->rho;
         state.UT = this->UT;
         state.tickCount = this->tickCount;
+        state.seed = rng.getSeed();
 
         for (size_t x = 0; x < this->height; ++x) {
+            std::copy_n(this->field[x], width, state.field[x]);
+            std::copy_n(this->dirs[x], width, state.dirs[x]);
+            std::copy_n(this->lastUse[x], width, state.lastUse[x]);
             for (size_t y = 0; y < this->width; ++y) {
-                state.field[x][y] = this->field[x][y];
-                state.p[x][y] = this->p[x][y];
-                state.dirs[x][y] = this->dirs[x][y];
-                state.lastUse[x][y] = this->lastUse[x][y];
-
-                for (size_t k = 0; k < deltas.size(); k++) {
-                    state.velocity[x][y][k] = this->velocity.v[x][y][k];
+                state.p[x][y] = PAccumulator(this->p[x][y]);
+            }
+            for (size_t k = 0; k < deltas.size(); k++) {
+                for (size_t y = 0; y < this->width; ++y) {
+                    state.velocity[k][x][y] =
+                        VelocityAccumulator(this->velocity.v[k][x][y]);
                 }
             }
         }
-
-        return state;
     }
 
 protected:
@@ -257,27 +300,24 @@ protected:
     struct VectorField {
         VectorMatrix<T> v;
 
-        T &add(int x, int y, int dx, int dy, T dv) {
-            return get(x, y, dx, dy) += dv;
+        VectorField(size_t height, size_t width) : v(height, width) {}
+
+        T &add(int x, int y, int dx, int dy, Accumulator<T> dv) {
+            T &value = get(x, y, dx, dy);
+            return value = Accumulator<T>(value) + dv;
         }
 
         T &get(int x, int y, int dx, int dy) {
-            return v[x][y][getDeltaIndex(dx, dy)];
+            return v[getDeltaIndex(dx, dy)][x][y];
         }
 
-        void reset() {
-            for (auto &row : v) {
-                for (auto &elem : row) {
-                    elem.fill(0);
-                }
-            }
-        }
+        void reset() { v.fill(Accumulator<T>(0)); }
     };
 
     struct ParticleParams {
-        char type;
-        PType cur_p;
-        std::array<VelocityType, deltas.size()> v;
+        char type{};
+        PType cur_p{};
+        std::array<VelocityType, deltas.size()> v{};
         FluidSimulation &sim;
 
         ParticleParams(FluidSimulation &sim) : sim(sim) {}
@@ -285,7 +325,9 @@ protected:
         void swap_with(int x, int y) {
             std::swap(sim.field[x][y], type);
             std::swap(sim.p[x][y], cur_p);
-            std::swap(sim.velocity.v[x][y], v);
+            for (size_t k = 0; k < deltas.size(); ++k) {
+                std::swap(sim.velocity.v[k][x][y], v[k]);
+            }
         }
     };
 
@@ -294,28 +336,78 @@ protected:
     const Fixed<> g;
     const std::array<Fixed<>, rhoSize> rho;
 
-    Matrix<char> field;
+    Matrix<char> field{height, width};
 
-    Matrix<PType> p, old_p;
+    Matrix<PType> p{height, width}, old_p{height, width};
 
-    VectorField<VelocityType> velocity;
-    VectorField<VelocityFlowType> velocityFlow;
+    VectorField<VelocityType> velocity{height, width};
+    VectorField<VelocityFlowType> velocityFlow{height, width};
 
-    Matrix<int> lastUse{};
-    Matrix<int> dirs{};
+    Matrix<int> lastUse{height, width};
+    Matrix<int> dirs{height, width};
     int UT = 0;
 
     unsigned tickCount = 0;
+    // Steps without changes since last tick. States are saved at ticks, so
+    // it's 0 after loading save.
+    unsigned tickSteps = 0;
+
+    // Draws are keyed by tick, step in tick, cell and number of draw of
+    // cell in step, so they don't depend on order of cells or rounds of
+    // flow search and are same after loading save.
+    CounterRandom rng;
 
     ThreadPool pool;
+    StepProfiler profiler;
+
+    Matrix<Fixed<>> flowCache{height, width};
+    // Round of flow search, in which cell was queued.
+    Matrix<int> flowQueued{height, width};
+
+    // Walls never move, so cells, that aren't walls, are found once.
+    // Cells are in row order, cells of row x start at openRowBegin[x].
+    std::vector<std::pair<size_t, size_t>> openCells;
+    std::vector<size_t> openRowBegin;
+    // Bit is set, if cell isn't wall.
+    BitGrid<Height, Width> open{height, width};
+    // Bit is set, if cell and its neighbour in direction k aren't walls.
+    std::array<BitGrid<Height, Width>, deltas.size()> openTo;
+
+    struct FlowFrame {
+        int x, y;
+        Fixed<> lim, ret;
+        size_t dir;
+    };
+
+    /// @brief Rows [xBegin, xEnd) of field, where flow is searched.
+    struct FlowRegion {
+        size_t xBegin, xEnd;
+        int ut = 0;
+        std::vector<FlowFrame> stack{};
+        std::vector<std::pair<size_t, size_t>> current{}, next{};
+        FlowCounters counters{};
+    };
+
+    static constexpr size_t flowBandHeight = 32;
+    // Rows in one chunk of parallel row passes.
+    static constexpr size_t rowGrain = 8;
+
+    FlowSolver flowSolver;
 
-    std::vector<std::vector<Fixed<>>> flowCache{height,
-                                                std::vector<Fixed<>>(width)};
+    // Row buffers of kinetic energy pass, delta row for each direction.
+    std::array<std::vector<VelocityAccumulator>, deltas.size()> kineticDelta =
+        makeKineticDelta();
+    std::vector<VelocityType> kineticFlow = std::vector<VelocityType>(width);
 
-    std::mt19937_64 rnd{1337};
+    FlowRegion flowField{0, height};
+    std::vector<FlowRegion> flowBands = makeFlowBands();
 
-    Fixed<> random01() {
-        return Fixed<>::fromRaw((rnd() & ((1LL << Fixed<>::K) - 1)));
+    /// @brief Random number in [0, 1) for draw of cell (x, y) in current
+    /// step. Draw 0 decides, if cell moves, next draws choose direction.
+    Fixed<> random01(int x, int y, unsigned draw) const {
+        uint64_t key = (uint64_t(tickCount) << 32) | tickSteps;
+        return Fixed<>::fromRaw(rng(key, x, y, draw) &
+                                ((1LL << Fixed<>::K) - 1));
     }
 
     Fixed<> moveProb(int x, int y) {
@@ -323,10 +415,10 @@ protected:
         for (size_t i = 0; i < deltas.size(); ++i) {
             auto [dx, dy] = deltas[i];
             int nx = x + dx, ny = y + dy;
-            if (field[nx][ny] == '#' || lastUse[nx][ny] == UT) {
+            if (!openTo[i].test(x, y) || lastUse[nx][ny] == UT) {
                 continue;
             }
-            auto v = velocity.get(x, y, dx, dy);
+            auto v = VelocityAccumulator(velocity.get(x, y, dx, dy));
             if (v < 0) {
                 continue;
             }
@@ -335,64 +427,268 @@ protected:
         return sum;
     }
 
-    std::tuple<Fixed<>, bool, std::pair<int, int>> propagateFlow(int x, int y,
-                                                                 Fixed<> lim) {
-        lastUse[x][y] = UT - 1;
+    void findOpenCells() {
+        if constexpr (isDynamic) {
+            for (auto &mask : openTo) {
+                mask = BitGrid<Height, Width>(height, width);
+            }
+        }
+
+        openCells.clear();
+        openRowBegin.assign(height + 1, 0);
+        for (size_t x = 0; x < height; ++x) {
+            openRowBegin[x] = openCells.size();
+            for (size_t y = 0; y < width; ++y) {
+                if (field[x][y] == '#') {
+                    continue;
+                }
+                openCells.push_back({x, y});
+                open.set(x, y);
+                for (size_t k = 0; k < deltas.size(); ++k) {
+                    auto [dx, dy] = deltas[k];
+                    openTo[k].set(x, y, field[x + dx][y + dy] != '#');
+                }
+            }
+        }
+        openRowBegin[height] = openCells.size();
+    }
+
+    std::array<std::vector<VelocityAccumulator>, deltas.size()>
+    makeKineticDelta() const {
+        std::array<std::vector<VelocityAccumulator>, deltas.size()> delta;
+        for (auto &row : delta) {
+            row.resize(width);
+        }
+        return delta;
+    }
+
+    std::vector<FlowRegion> makeFlowBands() const {
+        std::vector<FlowRegion> bands;
+        for (size_t x = 0; x < height; x += flowBandHeight) {
+            bands.push_back({x, std::min(height, x + flowBandHeight)});
+        }
+        return bands;
+    }
+
+    /// @brief Propagate flow until it is possible inside region.
+    /// After first round only cells near found flows are checked.
+    void makeFlow(FlowRegion &region) {
+        auto &current = region.current;
+        auto &next = region.next;
+        current.assign(openCells.begin() + openRowBegin[region.xBegin],
+                       openCells.begin() + openRowBegin[region.xEnd]);
+        next.clear();
+
+        bool any_prop;
+        do {
+            region.ut += 2;
+            any_prop = false;
+            if constexpr (profileEnabled) {
+                region.counters.rounds++;
+            }
+
+            // Cell is queued once per round, repeated entries of cell
+            // don't change anything.
+            auto queue = [&](size_t x, size_t y) {
+                if (flowQueued[x][y] != region.ut) {
+                    flowQueued[x][y] = region.ut;
+                    next.push_back({x, y});
+                }
+            };
+
+            for (auto [x, y] : current) {
+                if (lastUse[x][y] != region.ut) {
+                    auto [t, local_prop, _] =
+                        flowSolver == FlowSolver::recursive
+                            ? propagateFlow(region, x, y, 1, 1)
+                            : propagateFlowIterative(region, x, y, 1);
+                    if (t > 0) {
+                        queue(x, y);
+                        for (size_t k = 0; k < deltas.size(); ++k) {
+                            auto [dx, dy] = deltas[k];
+                            size_t nx = x + dx, ny = y + dy;
+                            if (openTo[k].test(x, y) && nx >= region.xBegin &&
+                                nx < region.xEnd) {
+                                queue(nx, ny);
+                            }
+                        }
+                        any_prop = true;
+                    }
+                } else if (flowCache[x][y] > 0) {
+                    queue(x, y);
+                }
+            }
+
+            swap(current, next);
+            next.clear();
+        } while (any_prop);
+    }
+
+    /// @brief Find flow from (x, y) with given limit.
+    /// depth is depth of recursion, it's used only by profiler.
+    std::tuple<Fixed<>, bool, std::pair<int, int>> propagateFlow(
+        FlowRegion &region, int x, int y, Fixed<> lim, size_t depth) {
+        const int ut = region.ut;
+        if constexpr (profileEnabled) {
+            region.counters.addCall(depth);
+        }
+        lastUse[x][y] = ut - 1;
         Fixed<> ret = 0;
 
-        for (auto [dx, dy] : deltas) {
+        for (size_t k = 0; k < deltas.size(); ++k) {
+            auto [dx, dy] = deltas[k];
             int nx = x + dx, ny = y + dy;
-            if (field[nx][ny] == '#' || lastUse[nx][ny] >= UT) {
+            if (!openTo[k].test(x, y) || lastUse[nx][ny] >= ut) {
                 continue;
             };
 
-            auto cap = velocity.get(x, y, dx, dy);
-            auto flow = velocityFlow.get(x, y, dx, dy);
+            auto cap = VelocityAccumulator(velocity.get(x, y, dx, dy));
+            auto flow = VelocityFlowAccumulator(velocityFlow.get(x, y, dx, dy));
             if (flow == cap) {
                 continue;
             }
 
-            VelocityFlowType vp =
-                std::min(VelocityType(lim), cap - VelocityType(flow));
-            if (lastUse[nx][ny] == UT - 1) {
+            VelocityFlowAccumulator vp = std::min(
+                VelocityAccumulator(lim), cap - VelocityAccumulator(flow));
+            if (lastUse[nx][ny] == ut - 1) {
                 velocityFlow.add(x, y, dx, dy, vp);
-                lastUse[x][y] = UT;
+                lastUse[x][y] = ut;
                 flowCache[x][y] = vp;
                 return {vp, true, {nx, ny}};
             }
 
-            auto [t, prop, end] = propagateFlow(nx, ny, vp);
+            auto [t, prop, end] = propagateFlow(region, nx, ny, vp, depth + 1);
 
             ret += t;
             if (prop) {
-                velocityFlow.add(x, y, dx, dy, VelocityFlowType(t));
-                lastUse[x][y] = UT;
+                velocityFlow.add(x, y, dx, dy, VelocityFlowAccumulator(t));
+                lastUse[x][y] = ut;
                 flowCache[x][y] = t;
                 return {t, prop && end != std::pair(x, y), end};
             }
         }
 
-        lastUse[x][y] = UT;
+        lastUse[x][y] = ut;
         flowCache[x][y] = ret;
         return {ret, false, {0, 0}};
     }
 
+    /// @brief Same as propagateFlow, but uses explicit stack instead of
+    /// recursion and doesn't leave rows of region.
+    std::tuple<Fixed<>, bool, std::pair<int, int>> propagateFlowIterative(
+        FlowRegion &region, int x, int y, Fixed<> lim) {
+        const int ut = region.ut;
+        auto &stack = region.stack;
+        stack.clear();
+
+        lastUse[x][y] = ut - 1;
+        stack.push_back({x, y, lim, 0, 0});
+        if constexpr (profileEnabled) {
+            region.counters.addCall(1);
+        }
+
+        // Result of last finished call.
+        Fixed<> t = 0;
+        bool prop = false;
+        std::pair<int, int> end{0, 0};
+        bool returned = false;
+
+        while (!stack.empty()) {
+            FlowFrame &f = stack.back();
+
+            if (returned) {
+                returned = false;
+                f.ret += t;
+                if (prop) {
+                    auto [dx, dy] = deltas[f.dir - 1];
+                    velocityFlow.add(f.x, f.y, dx, dy,
+                                     VelocityFlowAccumulator(t));
+                    lastUse[f.x][f.y] = ut;
+                    flowCache[f.x][f.y] = t;
+                    prop = end != std::pair(f.x, f.y);
+                    stack.pop_back();
+                    returned = true;
+                    continue;
+                }
+            }
+
+            bool call = false;
+            FlowFrame callee;
+            while (f.dir < deltas.size()) {
+                size_t k = f.dir++;
+                auto [dx, dy] = deltas[k];
+                int nx = f.x + dx, ny = f.y + dy;
+                if (size_t(nx) < region.xBegin || size_t(nx) >= region.xEnd ||
+                    !openTo[k].test(f.x, f.y) || lastUse[nx][ny] >= ut) {
+                    continue;
+                }
+
+                auto cap = VelocityAccumulator(velocity.get(f.x, f.y, dx, dy));
+                auto flow = VelocityFlowAccumulator(
+                    velocityFlow.get(f.x, f.y, dx, dy));
+                if (flow == cap) {
+                    continue;
+                }
+
+                VelocityFlowAccumulator vp =
+                    std::min(VelocityAccumulator(f.lim),
+                             cap - VelocityAccumulator(flow));
+                if (lastUse[nx][ny] == ut - 1) {
+                    velocityFlow.add(f.x, f.y, dx, dy, vp);
+                    lastUse[f.x][f.y] = ut;
+                    flowCache[f.x][f.y] = vp;
+                    t = vp;
+                    prop = true;
+                    end = {nx, ny};
+                    returned = true;
+                    break;
+                }
+
+                lastUse[nx][ny] = ut - 1;
+                callee = {nx, ny, vp, 0, 0};
+                call = true;
+                break;
+            }
+
+            if (returned) {
+                stack.pop_back();
+            } else if (call) {
+                stack.push_back(callee);
+                if constexpr (profileEnabled) {
+                    region.counters.addCall(stack.size());
+                }
+            } else {
+                lastUse[f.x][f.y] = ut;
+                flowCache[f.x][f.y] = f.ret;
+                t = f.ret;
+                prop = false;
+                end = {0, 0};
+                stack.pop_back();
+                returned = true;
+            }
+        }
+
+        return {t, prop, end};
+    }
+
     void propagateStop(int x, int y, bool force = false) {
         if (!force) {
-            for (auto [dx, dy] : deltas) {
+            for (size_t k = 0; k < deltas.size(); ++k) {
+                auto [dx, dy] = deltas[k];
                 int nx = x + dx, ny = y + dy;
-                if (field[nx][ny] != '#' && lastUse[nx][ny] < UT - 1 &&
-                    velocity.get(x, y, dx, dy) > 0) {
+                if (openTo[k].test(x, y) && lastUse[nx][ny] < UT - 1 &&
+                    VelocityAccumulator(velocity.get(x, y, dx, dy)) > 0) {
                     return;
                 }
             }
         }
 
         lastUse[x][y] = UT;
-        for (auto [dx, dy] : deltas) {
+        for (size_t k = 0; k < deltas.size(); ++k) {
+            auto [dx, dy] = deltas[k];
             int nx = x + dx, ny = y + dy;
-            if (field[nx][ny] == '#' || lastUse[nx][ny] == UT ||
-                velocity.get(x, y, dx, dy) > 0) {
+            if (!openTo[k].test(x, y) || lastUse[nx][ny] == UT ||
+                VelocityAccumulator(velocity.get(x, y, dx, dy)) > 0) {
                 continue;
             }
             propagateStop(nx, ny);
@@ -403,6 +699,7 @@ protected:
         lastUse[x][y] = UT - is_first;
         bool ret = false;
         int nx = -1, ny = -1;
+        unsigned draw = 1;
 
         do {
             std::array<Fixed<>, deltas.size()> tres;
@@ -410,11 +707,11 @@ protected:
             for (size_t i = 0; i < deltas.size(); ++i) {
                 auto [dx, dy] = deltas[i];
                 int nx = x + dx, ny = y + dy;
-                if (field[nx][ny] == '#' || lastUse[nx][ny] == UT) {
+                if (!openTo[i].test(x, y) || lastUse[nx][ny] == UT) {
                     tres[i] = sum;
                     continue;
                 }
-                auto v = velocity.get(x, y, dx, dy);
+                auto v = VelocityAccumulator(velocity.get(x, y, dx, dy));
                 if (v < 0) {
                     tres[i] = sum;
                     continue;
@@ -427,14 +724,14 @@ protected:
                 break;
             }
 
-            Fixed<> p = random01() * sum;
+            Fixed<> p = random01(x, y, draw++) * sum;
             size_t d = std::ranges::upper_bound(tres, p) - tres.begin();
 
             auto [dx, dy] = deltas[d];
             nx = x + dx;
             ny = y + dy;
-            assert(velocity.get(x, y, dx, dy) > 0 && field[nx][ny] != '#' &&
-                   lastUse[nx][ny] < UT);
+            assert(VelocityAccumulator(velocity.get(x, y, dx, dy)) > 0 &&
+                   openTo[d].test(x, y) && lastUse[nx][ny] < UT);
 
             ret = (lastUse[nx][ny] == UT - 1 || propagateMove(nx, ny, false));
         } while (!ret);
@@ -443,13 +740,14 @@ protected:
         for (size_t i = 0; i < deltas.size(); ++i) {
             auto [dx, dy] = deltas[i];
             int nx = x + dx, ny = y + dy;
-            if (field[nx][ny] != '#' && lastUse[nx][ny] < UT - 1 &&
-                velocity.get(x, y, dx, dy) < 0) {
+            if (openTo[i].test(x, y) && lastUse[nx][ny] < UT - 1 &&
+                VelocityAccumulator(velocity.get(x, y, dx, dy)) < 0) {
                 propagateStop(nx, ny);
             }
         }
 
         if (ret && !is_first) {
+            profiler.addMovedCell();
             ParticleParams pp(*this);
             pp.swap_with(x, y);
             pp.swap_with(nx, ny);
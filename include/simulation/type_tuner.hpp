@@ -0,0 +1,59 @@
+#pragma once
+
+#include <cstdint>
+#include <simulation/common.hpp>
+#include <string>
+#include <types/type.hpp>
+#include <vector>
+
+/// @brief Types of p, velocity and velocity flow.
+struct TypeCombination {
+    Type pType, velocityType, velocityFlowType;
+
+    bool operator==(const TypeCombination&) const = default;
+};
+
+struct TuneOptions {
+    // steps of each run
+    unsigned steps = 50;
+    // max share of cells, which differ from reference after steps
+    double tolerance = 0.02;
+    // time budget of one run (in seconds)
+    double timeLimit = 10;
+    unsigned threads = 1;
+    FlowSolver flowSolver = FlowSolver::recursive;
+};
+
+/// @brief Run of one combination of types.
+struct TuneCandidate {
+    TypeCombination types;
+    unsigned ticks = 0;
+    double seconds = 0;
+    // share of cells, which differ from reference after same steps
+    double divergence = 0;
+    // message of error, if run failed
+    std::string error;
+
+    double getTicksPerSecond() const;
+};
+
+struct TuneResult {
+    TypeCombination best;
+    std::vector<TuneCandidate> candidates;
+};
+
+/// @brief Combination of types, which results are used as reference.
+TypeCombination getReferenceTypes();
+
+/// @brief Run every combination of compiled in types on state and choose
+/// the fastest one, which divergence from reference isn't greater than
+/// tolerance. Each run is made in child process, so run, that fails
+/// assert or doesn't end in time, is only marked as failed.
+/// Throws runtime_error, if no combination is accurate enough.
+TuneResult tuneTypes(const FluidSimulationState& state,
+                     const TuneOptions& options);
+
+/// @brief Key of tuning of state with options by compiled in types.
+/// Same key means, that tuning gives same choice (up to timings).
+uint64_t getTuneKey(const FluidSimulationState& state,
+                    const TuneOptions& options);
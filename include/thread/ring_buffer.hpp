@@ -0,0 +1,49 @@
+#pragma once
+
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+/// @brief Double-ended queue in one circular buffer.
+/// Memory is allocated only when buffer grows, it never shrinks.
+template <typename T>
+class RingBuffer {
+public:
+    bool empty() const { return count == 0; }
+    size_t size() const { return count; }
+
+    void pushBack(T value) {
+        if (count == data.size()) {
+            grow();
+        }
+        data[(head + count) % data.size()] = std::move(value);
+        count++;
+    }
+
+    T popBack() {
+        count--;
+        return std::move(data[(head + count) % data.size()]);
+    }
+
+    T popFront() {
+        T value = std::move(data[head]);
+        head = (head + 1) % data.size();
+        count--;
+        return value;
+    }
+
+private:
+    static constexpr size_t minCapacity = 16;
+
+    std::vector<T> data;
+    size_t head = 0, count = 0;
+
+    void grow() {
+        std::vector<T> grown(data.empty() ? minCapacity : data.size() * 2);
+        for (size_t i = 0; i < count; ++i) {
+            grown[i] = std::move(data[(head + i) % data.size()]);
+        }
+        data = std::move(grown);
+        head = 0;
+    }
+};
@@ -1,56 +1,167 @@
 #pragma once
 
-#include <any>
 #include <atomic>
-#include <functional>
+#include <cstddef>
 #include <memory>
+#include <mutex>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
 
+class TaskAllocator;
+
+/// @brief Type-erased task.
+/// Callable and then its result are kept in inline storage, if they fit.
 class Task {
 public:
-    using TaskFunction = std::function<std::any()>;
+    static constexpr size_t storageSize = 64;
 
-    Task(TaskFunction&& func) : func(std::move(func)) {}
-    Task(const Task& other) : func(other.func), isReady(other.isReady.load()){};
-
-    template <typename T>
-    T getResult() const {
-        return std::any_cast<T>(result);
-    }
+    Task(const Task&) = delete;
+    Task& operator=(const Task&) = delete;
+    ~Task() { reset(); }
 
     bool hasResult() const { return isReady; }
 
     void waitResult() const { isReady.wait(false); }
 
 private:
+    friend class TaskAllocator;
     friend class ThreadPool;
+    template <typename R>
+    friend class TaskFuture;
+
+    template <typename T>
+    static constexpr bool fitsInline =
+        sizeof(T) <= storageSize &&
+        alignof(T) <= alignof(std::max_align_t) &&
+        std::is_nothrow_move_constructible_v<T>;
+
+    alignas(std::max_align_t) std::byte storage[storageSize];
+    void (*runFunc)(Task&) = nullptr;
+    // destroys callable or result in storage
+    void (*destroyFunc)(Task&) = nullptr;
 
-    TaskFunction func;
-    std::any result;
     std::atomic<bool> isReady{false};
+    std::atomic<unsigned> refs{0};
+    TaskAllocator* allocator = nullptr;
+
+    Task() = default;
+
+    template <typename T, typename... Args>
+    void emplace(Args&&... args) {
+        if constexpr (fitsInline<T>) {
+            new (storage) T(std::forward<Args>(args)...);
+        } else {
+            new (storage) T*(new T(std::forward<Args>(args)...));
+        }
+    }
+
+    template <typename T>
+    T& get() {
+        if constexpr (fitsInline<T>) {
+            return *std::launder(reinterpret_cast<T*>(storage));
+        } else {
+            return **std::launder(reinterpret_cast<T**>(storage));
+        }
+    }
+
+    template <typename T>
+    void destroy() {
+        if constexpr (fitsInline<T>) {
+            get<T>().~T();
+        } else {
+            delete &get<T>();
+        }
+    }
+
+    /// @brief Store callable, that returns R.
+    template <typename R, typename F>
+    void init(F&& f) {
+        using Func = std::decay_t<F>;
+
+        emplace<Func>(std::forward<F>(f));
+        destroyFunc = [](Task& task) { task.destroy<Func>(); };
+        runFunc = [](Task& task) {
+            if constexpr (std::is_void_v<R>) {
+                task.get<Func>()();
+                task.destroy<Func>();
+                task.destroyFunc = nullptr;
+            } else {
+                R result = task.get<Func>()();
+                task.destroy<Func>();
+                task.emplace<R>(std::move(result));
+                task.destroyFunc = [](Task& task) { task.destroy<R>(); };
+            }
+        };
+    }
 
     void run() {
-        result = func();
+        runFunc(*this);
         isReady = true;
+        isReady.notify_all();
+    }
+
+    void reset() {
+        if (destroyFunc) {
+            destroyFunc(*this);
+            destroyFunc = nullptr;
+        }
+        runFunc = nullptr;
+        isReady = false;
     }
+
+    void addRef() { refs.fetch_add(1, std::memory_order_relaxed); }
+    /// @brief Return task to allocator, if it's last reference.
+    void release();
 };
 
-template <typename F, typename... Args>
-std::shared_ptr<Task> createTask(F&& f, Args&&... args) {
-    auto binded = std::bind(std::forward<F>(f), std::forward<Args>(args)...);
+/// @brief Reuses finished tasks, so tasks are allocated only while number
+/// of simultaneously alive tasks grows.
+class TaskAllocator {
+public:
+    /// @brief Get empty task with one reference.
+    Task* allocate();
+    void free(Task* task);
+
+private:
+    std::mutex mutex;
+    std::vector<Task*> freeTasks;
+    std::vector<std::unique_ptr<Task>> tasks;
+};
 
-    Task::TaskFunction taskFunc;
-    if constexpr (std::is_void_v<std::invoke_result_t<F, Args...>>) {
-        // Void function
-        taskFunc = [binded = std::move(binded)]() -> std::any {
-            binded();
-            return std::any();
-        };
-    } else {
-        // Non-void function
-        taskFunc = [binded = std::move(binded)]() -> std::any {
-            return binded();
-        };
+/// @brief Handle to result of task.
+template <typename R>
+class TaskFuture {
+public:
+    TaskFuture() = default;
+    explicit TaskFuture(Task* task) : task(task) { task->addRef(); }
+    TaskFuture(const TaskFuture& other) : TaskFuture(other.task) {}
+    TaskFuture(TaskFuture&& other) noexcept
+        : task(std::exchange(other.task, nullptr)) {}
+    ~TaskFuture() {
+        if (task) {
+            task->release();
+        }
+    }
+
+    TaskFuture& operator=(TaskFuture other) noexcept {
+        std::swap(task, other.task);
+        return *this;
     }
 
-    return make_shared<Task>(std::move(taskFunc));
-}
+    bool isReady() const { return task->hasResult(); }
+
+    void wait() const { task->waitResult(); }
+
+    /// @brief Wait for task and get its result.
+    decltype(auto) get() const {
+        wait();
+        if constexpr (!std::is_void_v<R>) {
+            return static_cast<const R&>(task->get<R>());
+        }
+    }
+
+private:
+    Task* task = nullptr;
+};
@@ -1,34 +1,140 @@
 #pragma once
 
+#include <algorithm>
 #include <atomic>
-#include <condition_variable>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
 #include <mutex>
-#include <queue>
+#include <thread/ring_buffer.hpp>
 #include <thread/task.hpp>
 #include <thread>
+#include <tuple>
+#include <type_traits>
 #include <vector>
 
+/// @brief Pool of threads with own task deque for each thread.
+/// Idle threads steal tasks from deques of other threads.
+/// While PhaseScope is alive, idle threads spin for a while before parking,
+/// so next phase is picked up without wake up.
 class ThreadPool {
 public:
-    explicit ThreadPool(unsigned poolSize) : poolSize(poolSize) {
+    /// @brief Time, that caller of parallelFor waited for other threads.
+    struct SyncStats {
+        uint64_t phases = 0;
+        std::chrono::nanoseconds waitTime{0};
+    };
+
+    /// @brief Keeps idle threads spinning between phases while alive.
+    class PhaseScope {
+    public:
+        explicit PhaseScope(ThreadPool& pool) : pool(pool) {
+            pool.phaseScopes++;
+        }
+        PhaseScope(const PhaseScope&) = delete;
+        ~PhaseScope() { pool.phaseScopes--; }
+
+    private:
+        ThreadPool& pool;
+    };
+
+    explicit ThreadPool(unsigned poolSize)
+        : poolSize(poolSize),
+          // Spinning only takes time from working threads, if there are no
+          // free cores.
+          spinLimit(poolSize < std::thread::hardware_concurrency()
+                        ? defaultSpinLimit
+                        : 0),
+          // Calling thread takes one core, more helpers only wait for it.
+          maxHelpers(std::thread::hardware_concurrency() == 0
+                         ? poolSize
+                         : std::min(poolSize,
+                                    std::thread::hardware_concurrency() - 1)) {
         for (unsigned i = 0; i < poolSize; ++i) {
-            threads.emplace_back(&ThreadPool::run, this);
+            workers.push_back(std::make_unique<Worker>());
+        }
+        for (unsigned i = 0; i < poolSize; ++i) {
+            threads.emplace_back(&ThreadPool::run, this, i);
         }
     }
 
     ~ThreadPool() { stop(); }
 
+    /// @brief Run f(args...) in pool, or on calling thread, if pool has no
+    /// threads.
+    /// @return TaskFuture with result, it must not outlive pool.
     template <typename F, typename... Args>
-    std::shared_ptr<Task> addTask(F&& f, Args&&... args) {
-        auto task = createTask(std::forward<F>(f), std::forward<Args>(args)...);
+    auto addTask(F&& f, Args&&... args) {
+        using R = std::invoke_result_t<std::decay_t<F>&, std::decay_t<Args>&...>;
+
+        Task* task = allocator.allocate();
+        task->init<R>([f = std::forward<F>(f),
+                       ... args = std::forward<Args>(args)]() mutable -> R {
+            return std::invoke(f, args...);
+        });
 
-        {
-            std::lock_guard<std::mutex> lock(tasksMutex);
-            tasks.push(task);
+        TaskFuture<R> future(task);
+        pushTask(task);
+        return future;
+    }
+
+    /// @brief Call fn(i) for each i in [begin, end).
+    /// Range is split into chunks of grain indices, which are taken by
+    /// pool threads and calling thread. At most hardware_concurrency()
+    /// threads take chunks.
+    /// Must not be called from pool tasks.
+    template <typename F>
+    void parallelFor(size_t begin, size_t end, size_t grain, F&& fn) {
+        if (begin >= end) {
+            return;
+        }
+        grain = std::max<size_t>(grain, 1);
+
+        std::atomic<size_t> next{begin};
+        auto runChunks = [&]() {
+            while (true) {
+                size_t from = next.fetch_add(grain);
+                if (from >= end) {
+                    return;
+                }
+                size_t to = std::min(end, from + grain);
+                for (size_t i = from; i < to; ++i) {
+                    fn(i);
+                }
+            }
+        };
+
+        size_t chunks = (end - begin + grain - 1) / grain;
+        size_t helpers = std::min<size_t>(maxHelpers, chunks - 1);
+        // running is notified, when last helper is done with chunks, but
+        // helper still uses it in notify_all, so frame is left only after
+        // each helper decrements exiting as its last access to it.
+        std::atomic<size_t> running{helpers};
+        std::atomic<size_t> exiting{helpers};
+        for (size_t i = 0; i < helpers; ++i) {
+            addTask([&]() {
+                runChunks();
+                if (running.fetch_sub(1) == 1) {
+                    running.notify_all();
+                }
+                exiting.fetch_sub(1, std::memory_order_release);
+            });
         }
+        runChunks();
 
-        taskAddCondition.notify_one();
-        return task;
+        auto waitStart = std::chrono::steady_clock::now();
+        spinUntil([&]() { return running == 0; });
+        for (size_t r = running.load(); r != 0; r = running.load()) {
+            running.wait(r);
+        }
+        while (exiting.load(std::memory_order_acquire) != 0) {
+            std::this_thread::yield();
+        }
+        syncPhases++;
+        syncWaitNs += std::chrono::duration_cast<std::chrono::nanoseconds>(
+                          std::chrono::steady_clock::now() - waitStart)
+                          .count();
     }
 
     /// @brief Wait for all tasks to complete.
@@ -36,18 +142,70 @@ public:
     /// @brief Join all threads.
     void stop();
 
+    SyncStats getSyncStats() const {
+        return {syncPhases, std::chrono::nanoseconds(syncWaitNs.load())};
+    }
+    void resetSyncStats() {
+        syncPhases = 0;
+        syncWaitNs = 0;
+    }
+
 private:
+    struct Worker {
+        RingBuffer<Task*> tasks;
+        std::mutex mutex;
+
+        // parked thread waits for change of wakeEpoch
+        std::atomic<bool> parked{false};
+        std::atomic<unsigned> wakeEpoch{0};
+    };
+
     /// @brief Thread running function.
-    void run();
+    void run(unsigned index);
+    /// @brief Put task to deque of next thread.
+    void pushTask(Task* task);
+    /// @brief Take task from own deque or steal it from other threads.
+    Task* popTask(unsigned index);
+    /// @brief Sleep until task is added or pool is stopped.
+    void park(unsigned index);
+    /// @brief Wake one parked thread, starting search from index.
+    void wakeOne(unsigned index);
+
+    /// @brief Check pred, while it's false, at most spinLimit times, if
+    /// PhaseScope is alive.
+    template <typename Pred>
+    bool spinUntil(Pred&& pred) const {
+        unsigned limit = phaseScopes > 0 ? spinLimit : 0;
+        for (unsigned i = 0; i < limit; ++i) {
+            if (pred()) {
+                return true;
+            }
+#if defined(__x86_64__) || defined(__i386__)
+            __builtin_ia32_pause();
+#endif
+        }
+        return pred();
+    }
+
+    static constexpr unsigned defaultSpinLimit = 1 << 14;
 
     const unsigned poolSize;
+    const unsigned spinLimit;
+    // pool threads, that are used by parallelFor
+    const unsigned maxHelpers;
     std::vector<std::thread> threads;
-
-    std::queue<std::shared_ptr<Task>> tasks;
-    std::mutex tasksMutex;
-    std::condition_variable taskAddCondition;
-    std::condition_variable taskCompleteCondition;
+    std::vector<std::unique_ptr<Worker>> workers;
+    TaskAllocator allocator;
+    std::atomic<unsigned> nextWorker{0};
 
     std::atomic<bool> isStopped{false};
+    std::atomic<unsigned> phaseScopes{0};
+    std::atomic<unsigned> parkedThreads{0};
+    // tasks in deques
+    std::atomic<int> queuedTasks{0};
+    // tasks in deques or running
     std::atomic<unsigned> activeTasks{0};
-};
\ No newline at end of file
+
+    std::atomic<uint64_t> syncPhases{0};
+    std::atomic<int64_t> syncWaitNs{0};
+};
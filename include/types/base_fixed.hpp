@@ -1,15 +1,50 @@
 #pragma once
 
+#include <cstdint>
 #include <iostream>
+#include <limits>
+#include <type_traits>
+
+namespace BaseFixedInternal {
+
+/// @brief Narrowest type, that fits product of two N-bit numbers.
+template <size_t N>
+struct Wide {
+    using Type = std::conditional_t<
+        (N <= 16), int32_t,
+        std::conditional_t<(N <= 32), int64_t, __int128_t>>;
+};
+
+/// @brief Clamp x to range of St.
+template <typename St, typename T>
+constexpr St saturate(T x) {
+    if (x >= T(std::numeric_limits<St>::max())) {
+        return std::numeric_limits<St>::max();
+    }
+    if (x <= T(std::numeric_limits<St>::min())) {
+        return std::numeric_limits<St>::min();
+    }
+    return St(x);
+}
+
+}  // namespace BaseFixedInternal
 
 /// @brief Real number.
 /// @tparam St store type (int, long long, ...)
 /// @tparam _K bit quantity for fractional part.
-template <typename St, size_t _K>
+/// @tparam _Saturating clamp results of arithmetic and conversions to range
+/// of store type instead of wrapping them.
+template <typename St, size_t _K, bool _Saturating = false>
 struct BaseFixed {
     using StoreType = St;
     static constexpr size_t N = sizeof(StoreType) * 8;
     static constexpr size_t K = _K;
+    static constexpr bool Saturating = _Saturating;
+    // Type for intermediate results of multiplication and division.
+    // It's chosen by size of store, not by declared width of type: FastFixed
+    // wraps at size of its store (64 bits for int_fast32_t on LP64), so its
+    // values can use all bits of store.
+    using WideType = typename BaseFixedInternal::Wide<N>::Type;
 
     static_assert(!std::is_same<StoreType, void>::value,
                   "Invalid N parameter.");
@@ -17,20 +52,49 @@ struct BaseFixed {
 
     constexpr BaseFixed() : v(0) {}
     constexpr BaseFixed(int v) : BaseFixed(static_cast<long long>(v)) {}
-    constexpr BaseFixed(long long v) : v(v << K) {}
-    constexpr BaseFixed(float f) : v(f * (StoreType(1) << K)) {}
-    constexpr BaseFixed(double f) : v(f * (StoreType(1) << K)) {}
-
-    template <typename OtherStoreType, size_t OtherK>
-    constexpr BaseFixed(const BaseFixed<OtherStoreType, OtherK> &other) {
-        auto otherV = other.v;
-        if (OtherK > K) {
-            otherV >>= (OtherK - K);
+    constexpr BaseFixed(long long v) {
+        if constexpr (Saturating) {
+            this->v = narrow(__int128_t(v) << K);
+        } else {
+            this->v = v << K;
+        }
+    }
+    constexpr BaseFixed(float f) {
+        if constexpr (Saturating) {
+            v = narrow(double(f * (StoreType(1) << K)));
+        } else {
+            v = f * (StoreType(1) << K);
+        }
+    }
+    constexpr BaseFixed(double f) {
+        if constexpr (Saturating) {
+            v = narrow(f * (StoreType(1) << K));
+        } else {
+            v = f * (StoreType(1) << K);
         }
+    }
 
-        v = static_cast<StoreType>(otherV);
-        if (K > OtherK) {
-            v <<= (K - OtherK);
+    template <typename OtherStoreType, size_t OtherK, bool OtherSaturating>
+    constexpr BaseFixed(
+        const BaseFixed<OtherStoreType, OtherK, OtherSaturating> &other) {
+        if constexpr (Saturating) {
+            __int128_t otherV = other.v;
+            if (OtherK > K) {
+                otherV >>= (OtherK - K);
+            } else {
+                otherV <<= (K - OtherK);
+            }
+            v = narrow(otherV);
+        } else {
+            auto otherV = other.v;
+            if (OtherK > K) {
+                otherV >>= (OtherK - K);
+            }
+
+            v = static_cast<StoreType>(otherV);
+            if (K > OtherK) {
+                v <<= (K - OtherK);
+            }
         }
     }
 
@@ -46,21 +110,30 @@ struct BaseFixed {
     bool operator==(const BaseFixed &) const = default;
 
     friend BaseFixed operator+(BaseFixed a, BaseFixed b) {
+        if constexpr (Saturating) {
+            return BaseFixed::fromRaw(narrow(WideType(a.v) + b.v));
+        }
         return BaseFixed::fromRaw(a.v + b.v);
     }
 
     friend BaseFixed operator-(BaseFixed a, BaseFixed b) {
+        if constexpr (Saturating) {
+            return BaseFixed::fromRaw(narrow(WideType(a.v) - b.v));
+        }
         return BaseFixed::fromRaw(a.v - b.v);
     }
 
-    // TODO: remove __int128
     friend BaseFixed operator*(BaseFixed a, BaseFixed b) {
-        return BaseFixed::fromRaw(((__int128_t)a.v * b.v) >> K);
+        return BaseFixed::fromRaw(narrow(((WideType)a.v * b.v) >> K));
     }
 
-    // TODO: remove __int128
     friend BaseFixed operator/(BaseFixed a, BaseFixed b) {
-        return BaseFixed::fromRaw(((__int128_t)a.v << K) / b.v);
+        return BaseFixed::fromRaw(narrow(((WideType)a.v << K) / b.v));
+    }
+
+    /// @brief Same as a / BaseFixed(b), but without widening.
+    friend BaseFixed operator/(BaseFixed a, int b) {
+        return BaseFixed::fromRaw(a.v / b);
     }
 
     friend BaseFixed &operator+=(BaseFixed &a, BaseFixed b) {
@@ -79,11 +152,16 @@ struct BaseFixed {
         return a = a / b;
     }
 
-    friend BaseFixed operator-(BaseFixed x) { return BaseFixed::fromRaw(-x.v); }
+    friend BaseFixed operator-(BaseFixed x) {
+        if constexpr (Saturating) {
+            return BaseFixed::fromRaw(narrow(-WideType(x.v)));
+        }
+        return BaseFixed::fromRaw(-x.v);
+    }
 
     friend BaseFixed abs(BaseFixed x) {
         if (x.v < 0) {
-            x.v = -x.v;
+            x = -x;
         }
         return x;
     }
@@ -103,4 +181,15 @@ struct BaseFixed {
     explicit operator int64_t() const { return int64_t(v >> K); }
     explicit operator float() const { return v / (float)(StoreType(1) << K); }
     explicit operator double() const { return v / (double)(StoreType(1) << K); }
+
+private:
+    /// @brief Result of arithmetic in store type: clamped, if saturating,
+    /// truncated otherwise.
+    template <typename T>
+    static constexpr StoreType narrow(T x) {
+        if constexpr (Saturating) {
+            return BaseFixedInternal::saturate<StoreType>(x);
+        }
+        return StoreType(x);
+    }
 };
@@ -34,3 +34,7 @@ struct Store<64> {
 
 template <size_t N = 64, size_t K = 32>
 using Fixed = BaseFixed<typename FixedInternal::Store<N>::Type, K>;
+
+/// @brief Fixed, which arithmetic saturates instead of wrapping on overflow.
+template <size_t N = 64, size_t K = 32>
+using SatFixed = BaseFixed<typename FixedInternal::Store<N>::Type, K, true>;
@@ -0,0 +1,30 @@
+#pragma once
+
+/// @brief Number, which is stored as Store, but arithmetic with it is done
+/// in wider Accumulator. It's only converted to and from Accumulator, so
+/// sums and intermediate results keep precision of Accumulator, while
+/// grids of numbers take size of Store.
+template <typename Store, typename Accumulator>
+struct Mixed {
+    Store v;
+
+    constexpr Mixed() : v() {}
+    constexpr Mixed(const Accumulator &x) : v(Store(x)) {}
+
+    explicit constexpr operator Accumulator() const { return Accumulator(v); }
+};
+
+template <typename T>
+struct AccumulatorOf {
+    using type = T;
+};
+
+template <typename Store, typename Accumulator>
+struct AccumulatorOf<Mixed<Store, Accumulator>> {
+    using type = Accumulator;
+};
+
+/// @brief Type, in which arithmetic with values of T is done.
+/// It's T for all types except Mixed.
+template <typename T>
+using Accumulator = typename AccumulatorOf<T>::type;
@@ -0,0 +1,359 @@
+#pragma once
+
+#include <algorithm>
+#include <compare>
+#include <cstdint>
+#include <types/base_fixed.hpp>
+#include <types/mixed.hpp>
+#include <types/type.hpp>
+
+/// @brief Format of RuntimeNumber, that is chosen at runtime.
+struct NumberFormat {
+    enum class Kind : uint8_t { doubleKind, floatKind, fixedKind };
+
+    Kind kind = Kind::doubleKind;
+    // bits of store type and fractional bits, used only by fixedKind
+    uint8_t n = 64, k = 0;
+    // saturate instead of wrapping, used only by fixedKind
+    bool saturating = false;
+
+    /// @brief Format with same results as Type has (as its store type for
+    /// mixed type).
+    /// Throws invalid_argument, if type can't be instantiated.
+    static NumberFormat fromType(const Type& type);
+
+    static constexpr NumberFormat fixed(size_t n, size_t k,
+                                        bool saturating = false) {
+        return {Kind::fixedKind, uint8_t(n), uint8_t(k), saturating};
+    }
+
+    bool operator==(const NumberFormat&) const = default;
+};
+
+namespace RuntimeNumberInternal {
+
+/// @brief Truncate x to n-bit store type.
+inline int64_t wrap(int64_t x, uint8_t n) {
+    if (n >= 64) {
+        return x;
+    }
+    uint8_t shift = 64 - n;
+    return int64_t(uint64_t(x) << shift) >> shift;
+}
+
+inline int64_t shiftLeft(int64_t x, size_t shift) {
+    return int64_t(uint64_t(x) << shift);
+}
+
+/// @brief Result of arithmetic in fixed format f: clamped to n bits, if f
+/// is saturating, truncated otherwise.
+inline int64_t narrow(__int128_t x, const NumberFormat& f) {
+    if (f.saturating) {
+        __int128_t max = (__int128_t(1) << (f.n - 1)) - 1;
+        return int64_t(std::clamp(x, -max - 1, max));
+    }
+    return wrap(int64_t(x), f.n);
+}
+
+/// @brief Raw value of fixed format f, that is nearest to x (truncated).
+inline int64_t narrow(double x, const NumberFormat& f) {
+    if (f.saturating) {
+        int64_t max = int64_t((uint64_t(1) << (f.n - 1)) - 1);
+        if (x >= double(max)) {
+            return max;
+        }
+        if (x <= double(-max - 1)) {
+            return -max - 1;
+        }
+    }
+    return wrap(int64_t(x), f.n);
+}
+
+}  // namespace RuntimeNumberInternal
+
+/// @brief Real number, which format is chosen at runtime.
+/// Format is shared by all numbers of same Role in current thread, so one
+/// instantiation of code serves every type. Results are same as results of
+/// double, float and BaseFixed with same format.
+/// @tparam Role tag, that separates numbers with different formats.
+template <typename Role>
+struct RuntimeNumber {
+    using Kind = NumberFormat::Kind;
+
+    static inline thread_local NumberFormat format;
+
+    // raw value of BaseFixed for fixedKind, value for others
+    // (float values are kept rounded to float)
+    union {
+        int64_t v;
+        double d;
+    };
+
+    constexpr RuntimeNumber() : v(0) {}
+    RuntimeNumber(int x) : RuntimeNumber(static_cast<long long>(x)) {}
+    RuntimeNumber(long long x) {
+        const auto& f = format;
+        if (f.kind == Kind::fixedKind) {
+            v = RuntimeNumberInternal::narrow(__int128_t(x) << f.k, f);
+        } else {
+            d = round(f, double(x));
+        }
+    }
+    RuntimeNumber(float x) {
+        const auto& f = format;
+        if (f.kind == Kind::fixedKind) {
+            v = RuntimeNumberInternal::narrow(
+                double(x * float(int64_t(1) << f.k)), f);
+        } else {
+            d = x;
+        }
+    }
+    RuntimeNumber(double x) {
+        const auto& f = format;
+        if (f.kind == Kind::fixedKind) {
+            v = RuntimeNumberInternal::narrow(x * double(int64_t(1) << f.k),
+                                              f);
+        } else {
+            d = round(f, x);
+        }
+    }
+
+    template <typename St, size_t K, bool Sat>
+    RuntimeNumber(const BaseFixed<St, K, Sat>& x)
+        : RuntimeNumber(
+              convert(fromRaw(x.v),
+                      NumberFormat::fixed(BaseFixed<St, K, Sat>::N, K, Sat),
+                      format)) {}
+
+    template <typename OtherRole>
+    RuntimeNumber(const RuntimeNumber<OtherRole>& x)
+        : RuntimeNumber(convert(fromRaw(x.v), RuntimeNumber<OtherRole>::format,
+                                format)) {}
+
+    template <typename St, size_t K, bool Sat>
+    operator BaseFixed<St, K, Sat>() const {
+        return BaseFixed<St, K, Sat>::fromRaw(
+            St(convert(*this, format,
+                       NumberFormat::fixed(BaseFixed<St, K, Sat>::N, K, Sat))
+                   .v));
+    }
+
+    explicit operator double() const {
+        return convert(*this, format, {Kind::doubleKind}).d;
+    }
+
+    static RuntimeNumber fromRaw(int64_t x) {
+        RuntimeNumber ret;
+        ret.v = x;
+        return ret;
+    }
+
+    static RuntimeNumber fromValue(double x) {
+        RuntimeNumber ret;
+        ret.d = x;
+        return ret;
+    }
+
+    std::partial_ordering operator<=>(const RuntimeNumber& other) const {
+        if (format.kind == Kind::fixedKind) {
+            return v <=> other.v;
+        }
+        return d <=> other.d;
+    }
+
+    bool operator==(const RuntimeNumber& other) const {
+        return (*this <=> other) == 0;
+    }
+
+    /// @brief Floating numbers are compared as double like float and
+    /// double are, others are compared in format of left number like
+    /// BaseFixed are.
+    template <typename OtherRole>
+    std::partial_ordering operator<=>(
+        const RuntimeNumber<OtherRole>& other) const {
+        if (format.kind != Kind::fixedKind &&
+            RuntimeNumber<OtherRole>::format.kind != Kind::fixedKind) {
+            return d <=> other.d;
+        }
+        return *this <=> RuntimeNumber(other);
+    }
+
+    template <typename OtherRole>
+    bool operator==(const RuntimeNumber<OtherRole>& other) const {
+        return (*this <=> other) == 0;
+    }
+
+    friend RuntimeNumber operator+(RuntimeNumber a, RuntimeNumber b) {
+        const auto& f = format;
+        if (f.kind == Kind::fixedKind) {
+            return fromRaw(
+                RuntimeNumberInternal::narrow(__int128_t(a.v) + b.v, f));
+        }
+        if (f.kind == Kind::floatKind) {
+            return fromValue(float(a.d) + float(b.d));
+        }
+        return fromValue(a.d + b.d);
+    }
+
+    friend RuntimeNumber operator-(RuntimeNumber a, RuntimeNumber b) {
+        const auto& f = format;
+        if (f.kind == Kind::fixedKind) {
+            return fromRaw(
+                RuntimeNumberInternal::narrow(__int128_t(a.v) - b.v, f));
+        }
+        if (f.kind == Kind::floatKind) {
+            return fromValue(float(a.d) - float(b.d));
+        }
+        return fromValue(a.d - b.d);
+    }
+
+    friend RuntimeNumber operator*(RuntimeNumber a, RuntimeNumber b) {
+        const auto& f = format;
+        if (f.kind == Kind::fixedKind) {
+            return fromRaw(RuntimeNumberInternal::narrow(
+                ((__int128_t)a.v * b.v) >> f.k, f));
+        }
+        if (f.kind == Kind::floatKind) {
+            return fromValue(float(a.d) * float(b.d));
+        }
+        return fromValue(a.d * b.d);
+    }
+
+    friend RuntimeNumber operator/(RuntimeNumber a, RuntimeNumber b) {
+        const auto& f = format;
+        if (f.kind == Kind::fixedKind) {
+            return fromRaw(RuntimeNumberInternal::narrow(
+                ((__int128_t)a.v << f.k) / b.v, f));
+        }
+        if (f.kind == Kind::floatKind) {
+            return fromValue(float(a.d) / float(b.d));
+        }
+        return fromValue(a.d / b.d);
+    }
+
+    /// @brief Same as a / RuntimeNumber(b), but without widening.
+    friend RuntimeNumber operator/(RuntimeNumber a, int b) {
+        const auto& f = format;
+        if (f.kind == Kind::fixedKind) {
+            return fromRaw(RuntimeNumberInternal::wrap(a.v / b, f.n));
+        }
+        if (f.kind == Kind::floatKind) {
+            return fromValue(float(a.d) / b);
+        }
+        return fromValue(a.d / b);
+    }
+
+    friend RuntimeNumber& operator+=(RuntimeNumber& a, RuntimeNumber b) {
+        return a = a + b;
+    }
+
+    friend RuntimeNumber& operator-=(RuntimeNumber& a, RuntimeNumber b) {
+        return a = a - b;
+    }
+
+    friend RuntimeNumber& operator*=(RuntimeNumber& a, RuntimeNumber b) {
+        return a = a * b;
+    }
+
+    friend RuntimeNumber& operator/=(RuntimeNumber& a, RuntimeNumber b) {
+        return a = a / b;
+    }
+
+    /// @brief float is multiplied by double in double.
+    friend RuntimeNumber operator*(RuntimeNumber a, double b) {
+        if (format.kind == Kind::floatKind) {
+            return fromValue(float(a.d * b));
+        }
+        return a * RuntimeNumber(b);
+    }
+
+    friend RuntimeNumber& operator*=(RuntimeNumber& a, double b) {
+        return a = a * b;
+    }
+
+    friend RuntimeNumber operator-(RuntimeNumber x) {
+        const auto& f = format;
+        if (f.kind == Kind::fixedKind) {
+            return fromRaw(RuntimeNumberInternal::narrow(-__int128_t(x.v), f));
+        }
+        return fromValue(-x.d);
+    }
+
+private:
+    static double round(const NumberFormat& f, double x) {
+        return f.kind == Kind::floatKind ? float(x) : x;
+    }
+
+    /// @brief Convert x from one format to other as explicit cast of
+    /// corresponding types does.
+    static RuntimeNumber convert(RuntimeNumber x, const NumberFormat& from,
+                                 const NumberFormat& to) {
+        if (from == to) {
+            return x;
+        }
+        if (from.kind != Kind::fixedKind) {
+            if (to.kind != Kind::fixedKind) {
+                return fromValue(round(to, x.d));
+            }
+            // Store type of BaseFixed is multiplied in float for float.
+            int64_t one = int64_t(1) << to.k;
+            double v = from.kind == Kind::floatKind
+                           ? double(float(x.d) * float(one))
+                           : x.d * double(one);
+            return fromRaw(RuntimeNumberInternal::narrow(v, to));
+        }
+        if (to.kind == Kind::floatKind) {
+            return fromValue(float(x.v) / float(int64_t(1) << from.k));
+        }
+        if (to.kind == Kind::doubleKind) {
+            return fromValue(double(x.v) / double(int64_t(1) << from.k));
+        }
+
+        if (to.saturating) {
+            __int128_t v = x.v;
+            if (from.k > to.k) {
+                v >>= from.k - to.k;
+            } else {
+                v <<= to.k - from.k;
+            }
+            return fromRaw(RuntimeNumberInternal::narrow(v, to));
+        }
+
+        int64_t v = x.v;
+        if (from.k > to.k) {
+            v >>= from.k - to.k;
+        }
+        v = RuntimeNumberInternal::wrap(v, to.n);
+        if (to.k > from.k) {
+            v = RuntimeNumberInternal::wrap(
+                RuntimeNumberInternal::shiftLeft(v, to.k - from.k), to.n);
+        }
+        return fromRaw(v);
+    }
+};
+
+/// @brief Role of accumulator of numbers with Role. Its format is format
+/// of accumulator of mixed type, so RuntimeNumber emulates Mixed too.
+template <typename Role>
+struct AccumulatorRole {};
+
+template <typename Role>
+struct AccumulatorOf<RuntimeNumber<Role>> {
+    using type = RuntimeNumber<AccumulatorRole<Role>>;
+};
+
+/// @brief Sets format of RuntimeNumber<Role> in current thread until end
+/// of scope.
+template <typename Role>
+class NumberFormatScope {
+public:
+    explicit NumberFormatScope(const NumberFormat& format)
+        : previous(RuntimeNumber<Role>::format) {
+        RuntimeNumber<Role>::format = format;
+    }
+    NumberFormatScope(const NumberFormatScope&) = delete;
+    ~NumberFormatScope() { RuntimeNumber<Role>::format = previous; }
+
+private:
+    NumberFormat previous;
+};
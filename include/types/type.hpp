@@ -3,15 +3,39 @@
 #include <cstddef>
 #include <string>
 
-enum class TypeId { doubleType, floatType, fixedType, fastFixedType };
+enum class TypeId {
+    doubleType,
+    floatType,
+    fixedType,
+    fastFixedType,
+    satFixedType
+};
 
 struct Type {
     TypeId typeId;
     size_t n, k;
+    // Type of arithmetic with values, it differs from type above only for
+    // mixed type (see Mixed).
+    TypeId accumulatorId;
+    size_t accumulatorN, accumulatorK;
+
+    constexpr Type() : Type(TypeId::doubleType) {}
+    constexpr Type(TypeId id) : Type(id, 0, 0) {}
+    constexpr Type(TypeId id, size_t n, size_t k)
+        : typeId(id),
+          n(n),
+          k(k),
+          accumulatorId(id),
+          accumulatorN(n),
+          accumulatorK(k) {}
 
-    constexpr Type() : typeId(TypeId::doubleType), n(0), k(0) {}
-    constexpr Type(TypeId id) : typeId(id) {}
-    constexpr Type(TypeId id, size_t n, size_t k) : typeId(id), n(n), k(k) {}
+    constexpr bool isMixed() const { return getStore() != getAccumulator(); }
+    /// @brief Type, in which values are stored.
+    constexpr Type getStore() const { return Type(typeId, n, k); }
+    /// @brief Type, in which arithmetic with values is done.
+    constexpr Type getAccumulator() const {
+        return Type(accumulatorId, accumulatorN, accumulatorK);
+    }
 
     bool operator==(const Type&) const = default;
 };
@@ -28,4 +52,18 @@ constexpr Type fastFixedType(size_t n, size_t k) {
     return Type(TypeId::fastFixedType, n, k);
 }
 
+constexpr Type satFixedType(size_t n, size_t k) {
+    return Type(TypeId::satFixedType, n, k);
+}
+
+/// @brief Type, which values are stored as store, but arithmetic with them is
+/// done in accumulator. Only store and accumulator of types are used.
+constexpr Type mixedType(const Type& store, const Type& accumulator) {
+    Type type = store.getStore();
+    type.accumulatorId = accumulator.typeId;
+    type.accumulatorN = accumulator.n;
+    type.accumulatorK = accumulator.k;
+    return type;
+}
+
 std::string to_string(const Type& type);
\ No newline at end of file
@@ -0,0 +1,812 @@
+#include <getopt.h>
+#include <sys/resource.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cli/console_args.hpp>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <random>
+#include <simulation/factory.hpp>
+#include <simulation/kernels.hpp>
+#include <simulation/save_load.hpp>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <types/fast_fixed.hpp>
+#include <types/fixed.hpp>
+#include <vector>
+
+using namespace std;
+
+/*
+Benchmark of simulation for every combination of compiled in types, fields
+and thread counts. Each run is headless: simulation makes given number of
+ticks and only time is measured. Results are written as JSON, progress is
+written to stderr.
+Other modes measure parts of simulation separately:
+- kernels: row kernels with AVX2 and with scalar loop.
+- fixed-ops: multiplication and division of fixed types.
+- save-load: save and load of big state in old and current format.
+*/
+
+namespace {
+
+enum class BenchMode { simulation, kernels, fixedOps, saveLoad };
+
+BenchMode parseBenchMode(const std::string& mode) {
+    if (mode == "simulation") {
+        return BenchMode::simulation;
+    }
+    if (mode == "kernels") {
+        return BenchMode::kernels;
+    }
+    if (mode == "fixed-ops") {
+        return BenchMode::fixedOps;
+    }
+    if (mode == "save-load") {
+        return BenchMode::saveLoad;
+    }
+    throw invalid_argument("Unknown bench mode: " + mode + ".");
+}
+
+struct BenchArgs {
+    BenchMode mode = BenchMode::simulation;
+    // ticks of each run
+    unsigned ticks = 100;
+    std::vector<unsigned> threads = {1};
+    FlowSolver flowSolver = FlowSolver::recursive;
+    // text fields in addition to generated ones
+    std::vector<std::string> inputFiles;
+    // file for JSON, stdout if empty
+    std::string outputFile;
+};
+
+// clang-format off
+constexpr struct option longOptions[] = {
+    {"ticks",       required_argument, nullptr, 'n'},
+    {"threads",     required_argument, nullptr, 't'},
+    {"flow-solver", required_argument, nullptr, 'a'},
+    {"input",       required_argument, nullptr, 'i'},
+    {"output",      required_argument, nullptr, 'o'},
+    {"mode",        required_argument, nullptr, 'm'},
+    {nullptr, 0, nullptr, 0}
+};
+// clang-format on
+
+const char* shortOptions = "n:t:a:i:o:m:";
+
+BenchArgs parseBenchArguments(int argc, char* argv[]) {
+    BenchArgs args;
+
+    int c;
+    while ((c = getopt_long(argc, argv, shortOptions, longOptions, NULL)) !=
+           -1) {
+        switch (c) {
+            case 'n':
+                args.ticks = std::stoul(optarg);
+                break;
+            case 't': {
+                args.threads.clear();
+                stringstream list(optarg);
+                string count;
+                while (getline(list, count, ',')) {
+                    args.threads.push_back(std::stoul(count));
+                }
+                break;
+            }
+            case 'a':
+                args.flowSolver = parseFlowSolver(optarg);
+                break;
+            case 'i':
+                args.inputFiles.push_back(optarg);
+                break;
+            case 'o':
+                args.outputFile = optarg;
+                break;
+            case 'm':
+                args.mode = parseBenchMode(optarg);
+                break;
+            default:
+                throw invalid_argument("Invalid option");
+        }
+    }
+
+    if (args.ticks == 0) {
+        throw invalid_argument("--ticks option must be greater than 0.");
+    }
+    for (unsigned count : args.threads) {
+        if (count == 0) {
+            throw invalid_argument(
+                "--threads option must be greater than 0.");
+        }
+    }
+    return args;
+}
+
+struct BenchField {
+    std::string name;
+    FluidSimulationState state;
+};
+
+/// @brief Field like example: water at bottom, heavy fluid drop at top and
+/// shelf between them.
+BenchField generateField(size_t height, size_t width) {
+    DynamicMatrix<char> field(height, width, ' ');
+    for (size_t x = 0; x < height; ++x) {
+        for (size_t y = 0; y < width; ++y) {
+            if (x == 0 || y == 0 || x + 1 == height || y + 1 == width) {
+                field[x][y] = '#';
+            } else if (x >= height * 3 / 4) {
+                field[x][y] = '.';
+            } else if (x > height / 8 && x <= height / 8 + height / 8 + 1 &&
+                       y >= width * 5 / 8 && y < width * 3 / 4) {
+                field[x][y] = '*';
+            }
+        }
+    }
+    for (size_t y = width / 4; y < width / 2; ++y) {
+        field[height / 2][y] = '#';
+    }
+
+    FluidSimulationState state(std::move(field));
+    state.g = 10;
+    state.rho[' '] = 1;
+    state.rho['.'] = 100;
+    state.rho['*'] = 1000;
+    return {"generated(" + to_string(height) + "," + to_string(width) + ")",
+            std::move(state)};
+}
+
+std::vector<BenchField> getFields(const BenchArgs& args) {
+    std::vector<BenchField> fields;
+    auto sizes = FluidSimulationFactory::getStaticSizes();
+    if (sizes.empty()) {
+        sizes.push_back({36, 84});
+    }
+    for (auto [height, width] : sizes) {
+        if (height >= 4 && width >= 4) {
+            fields.push_back(generateField(height, width));
+        }
+    }
+    for (const auto& file : args.inputFiles) {
+        ifstream in(file);
+        if (!in) {
+            throw runtime_error("Can't open input file: " + file + ".");
+        }
+        fields.push_back({file, loadFluidSimulationStartState(in)});
+    }
+    return fields;
+}
+
+/// @brief Reset peak RSS of process, so next read gives peak of one run.
+void resetPeakRss() {
+    ofstream clearRefs("/proc/self/clear_refs");
+    clearRefs << "5";
+}
+
+/// @brief Peak RSS in KB.
+long getPeakRss() {
+    ifstream status("/proc/self/status");
+    string line;
+    while (getline(status, line)) {
+        if (line.rfind("VmHWM:", 0) == 0) {
+            return std::stol(line.substr(6));
+        }
+    }
+    // Peak of whole process, if procfs isn't available.
+    rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss;
+}
+
+struct BenchResult {
+    Type pType, velocityType, velocityFlowType;
+    std::string field;
+    size_t height, width;
+    bool isStatic, isSpecialized;
+    unsigned threads;
+    unsigned ticks, iterations;
+    double setupSeconds, seconds;
+    long peakRss;
+    StepProfile profile;
+};
+
+BenchResult runBench(const BenchArgs& args, const BenchField& field,
+                     const Type& pType, const Type& velocityType,
+                     const Type& velocityFlowType, unsigned threads) {
+    size_t height = field.state.getFieldHeight();
+    size_t width = field.state.getFieldWidth();
+    auto sizes = FluidSimulationFactory::getStaticSizes();
+
+    BenchResult result{pType, velocityType, velocityFlowType, field.name,
+                       height, width};
+    result.isSpecialized = FluidSimulationFactory::isSpecialized(
+        pType, velocityType, velocityFlowType);
+    // Generic engine has only dynamic field.
+    result.isStatic = result.isSpecialized &&
+                      find(sizes.begin(), sizes.end(),
+                           make_pair(height, width)) != sizes.end();
+    result.threads = threads;
+
+    resetPeakRss();
+    auto setupStart = chrono::steady_clock::now();
+    FactoryContext ctx = {height,
+                          width,
+                          pType,
+                          velocityType,
+                          velocityFlowType,
+                          threads,
+                          args.flowSolver,
+                          field.state,
+                          false};
+    auto simulation = FluidSimulationFactory(ctx).create();
+    auto start = chrono::steady_clock::now();
+
+    // Iterations without changes are limited, so still field ends run.
+    unsigned maxIterations = args.ticks * 10;
+    result.iterations = 0;
+    while (simulation->getTickCount() < args.ticks &&
+           result.iterations < maxIterations) {
+        simulation->step();
+        result.iterations++;
+    }
+
+    auto end = chrono::steady_clock::now();
+    result.ticks = simulation->getTickCount();
+    result.setupSeconds = chrono::duration<double>(start - setupStart).count();
+    result.seconds = chrono::duration<double>(end - start).count();
+    result.peakRss = getPeakRss();
+    result.profile = simulation->getProfile();
+    return result;
+}
+
+string quoteJson(const string& str) {
+    string quoted = "\"";
+    for (char c : str) {
+        if (c == '"' || c == '\\') {
+            quoted += '\\';
+        }
+        quoted += c;
+    }
+    return quoted + "\"";
+}
+
+void writeJson(ostream& out, const BenchArgs& args,
+               const std::vector<BenchResult>& results) {
+    out << "{\n";
+    out << "  \"version\": 1,\n";
+    out << "  \"ticks\": " << args.ticks << ",\n";
+    out << "  \"results\": [";
+    for (size_t i = 0; i < results.size(); ++i) {
+        const auto& r = results[i];
+        double ticksPerSecond = r.seconds > 0 ? r.ticks / r.seconds : 0;
+        double nsPerCellTick =
+            r.ticks > 0 ? r.seconds * 1e9 / r.ticks / (r.height * r.width) : 0;
+
+        out << (i == 0 ? "\n" : ",\n");
+        out << "    {";
+        out << "\"pType\": " << quoteJson(to_string(r.pType)) << ", ";
+        out << "\"velocityType\": " << quoteJson(to_string(r.velocityType))
+            << ", ";
+        out << "\"velocityFlowType\": "
+            << quoteJson(to_string(r.velocityFlowType)) << ", ";
+        out << "\"field\": " << quoteJson(r.field) << ", ";
+        out << "\"height\": " << r.height << ", ";
+        out << "\"width\": " << r.width << ", ";
+        out << "\"static\": " << (r.isStatic ? "true" : "false") << ", ";
+        out << "\"specialized\": " << (r.isSpecialized ? "true" : "false")
+            << ", ";
+        out << "\"threads\": " << r.threads << ", ";
+        out << "\"ticks\": " << r.ticks << ", ";
+        out << "\"iterations\": " << r.iterations << ", ";
+        out << "\"setupSeconds\": " << r.setupSeconds << ", ";
+        out << "\"seconds\": " << r.seconds << ", ";
+        out << "\"ticksPerSecond\": " << ticksPerSecond << ", ";
+        out << "\"nsPerCellTick\": " << nsPerCellTick << ", ";
+        out << "\"peakRssKb\": " << r.peakRss;
+        if (profileEnabled) {
+            out << ", \"phaseSeconds\": {";
+            for (size_t k = 0; k < phaseCount; ++k) {
+                out << (k == 0 ? "" : ", ") << quoteJson(to_string(Phase(k)))
+                    << ": "
+                    << chrono::duration<double>(r.profile.phaseTime[k]).count();
+            }
+            out << "}, ";
+            out << "\"flowRounds\": " << r.profile.flow.rounds << ", ";
+            out << "\"flowCalls\": " << r.profile.flow.calls << ", ";
+            out << "\"maxFlowDepth\": " << r.profile.flow.maxDepth << ", ";
+            out << "\"cellsMoved\": " << r.profile.cellsMoved << ", ";
+            out << "\"syncPhases\": " << r.profile.syncPhases << ", ";
+            out << "\"syncWaitSeconds\": "
+                << chrono::duration<double>(r.profile.syncWaitTime).count();
+        }
+        out << "}";
+    }
+    out << "\n  ]\n}\n";
+}
+
+/// @brief Keep memory at ptr, so stores to it aren't removed.
+void keepMemory(const void* ptr) { asm volatile("" : : "r"(ptr) : "memory"); }
+
+struct KernelResult {
+    std::string kernel;
+    Type type;
+    bool simd;
+    size_t lanes;
+    uint64_t cells;
+    double seconds;
+};
+
+// Kernels run on one row of wide field, so it stays in cache and only
+// kernel itself is measured.
+constexpr size_t kernelRowWidth = 1000;
+// Rows of generated field, kernels process them once per tick.
+constexpr size_t kernelRows = 1980;
+
+template <typename T, bool UseSimd>
+KernelResult benchAddIfOpen(const BenchArgs& args, const Type& type) {
+    mt19937 gen(1);
+    uniform_real_distribution<double> dist(-1, 1);
+    std::vector<T> values(kernelRowWidth);
+    for (auto& value : values) {
+        value = T(dist(gen));
+    }
+    std::vector<uint64_t> open((kernelRowWidth + 63) / 64);
+    for (auto& word : open) {
+        // Most cells are open, as in field with water.
+        word = gen() | gen();
+    }
+    Accumulator<T> add = Accumulator<T>(0.001);
+
+    uint64_t rows = uint64_t(args.ticks) * kernelRows;
+    auto start = chrono::steady_clock::now();
+    for (uint64_t i = 0; i < rows; ++i) {
+        kernels::addIfOpen<T, UseSimd>(values.data(), open.data(),
+                                       values.size(), add);
+        keepMemory(values.data());
+    }
+    auto end = chrono::steady_clock::now();
+    return {"addIfOpen",
+            type,
+            UseSimd,
+            UseSimd && kernels::hasAvx2() ? kernels::Simd<T>::lanes : 0,
+            rows * kernelRowWidth,
+            chrono::duration<double>(end - start).count()};
+}
+
+/// @brief takeFlow replaces velocities, so row is restored before each
+/// call, time of copy is included.
+template <typename T, bool UseSimd>
+KernelResult benchTakeFlow(const BenchArgs& args, const Type& type) {
+    mt19937 gen(1);
+    uniform_real_distribution<double> dist(-1, 1);
+    std::vector<T> source(kernelRowWidth), flow(kernelRowWidth);
+    for (size_t y = 0; y < kernelRowWidth; ++y) {
+        source[y] = T(dist(gen));
+        flow[y] = T(dist(gen) / 2 + 0.5);
+    }
+    std::vector<T> velocity(kernelRowWidth);
+    std::vector<Accumulator<T>> delta(kernelRowWidth);
+
+    uint64_t rows = uint64_t(args.ticks) * kernelRows;
+    auto start = chrono::steady_clock::now();
+    for (uint64_t i = 0; i < rows; ++i) {
+        std::copy(source.begin(), source.end(), velocity.begin());
+        kernels::takeFlow<T, UseSimd>(velocity.data(), flow.data(),
+                                      delta.data(), velocity.size());
+        keepMemory(velocity.data());
+        keepMemory(delta.data());
+    }
+    auto end = chrono::steady_clock::now();
+    return {"takeFlow",
+            type,
+            UseSimd,
+            UseSimd && kernels::hasAvx2() ? kernels::Simd<T>::lanes : 0,
+            rows * kernelRowWidth,
+            chrono::duration<double>(end - start).count()};
+}
+
+template <typename T>
+void benchKernels(const BenchArgs& args, const Type& type,
+                  std::vector<KernelResult>& results) {
+    results.push_back(benchAddIfOpen<T, false>(args, type));
+    results.push_back(benchAddIfOpen<T, true>(args, type));
+    results.push_back(benchTakeFlow<T, false>(args, type));
+    results.push_back(benchTakeFlow<T, true>(args, type));
+}
+
+std::vector<KernelResult> runKernelBench(const BenchArgs& args) {
+    std::vector<KernelResult> results;
+    benchKernels<double>(args, doubleType(), results);
+    benchKernels<float>(args, floatType(), results);
+    benchKernels<Fixed<32, 16>>(args, fixedType(32, 16), results);
+    benchKernels<Fixed<64, 32>>(args, fixedType(64, 32), results);
+    for (const auto& r : results) {
+        cerr << r.kernel << " " << to_string(r.type) << " "
+             << (r.simd ? "simd" : "scalar") << ": "
+             << r.seconds * 1e9 / r.cells << " ns/cell" << endl;
+    }
+    return results;
+}
+
+void writeJson(ostream& out, const BenchArgs& args,
+               const std::vector<KernelResult>& results) {
+    out << "{\n";
+    out << "  \"version\": 1,\n";
+    out << "  \"mode\": \"kernels\",\n";
+    out << "  \"ticks\": " << args.ticks << ",\n";
+    out << "  \"width\": " << kernelRowWidth << ",\n";
+    out << "  \"results\": [";
+    for (size_t i = 0; i < results.size(); ++i) {
+        const auto& r = results[i];
+        out << (i == 0 ? "\n" : ",\n");
+        out << "    {";
+        out << "\"kernel\": " << quoteJson(r.kernel) << ", ";
+        out << "\"type\": " << quoteJson(to_string(r.type)) << ", ";
+        out << "\"simd\": " << (r.simd ? "true" : "false") << ", ";
+        out << "\"lanes\": " << r.lanes << ", ";
+        out << "\"cells\": " << r.cells << ", ";
+        out << "\"seconds\": " << r.seconds << ", ";
+        out << "\"nsPerCell\": " << r.seconds * 1e9 / r.cells;
+        out << "}";
+    }
+    out << "\n  ]\n}\n";
+}
+
+struct FixedOpResult {
+    std::string op;
+    Type type;
+    // intermediate type of operation: "wide" is WideType of type,
+    // "int128" is __int128 for all types
+    std::string intermediate;
+    uint64_t ops;
+    double seconds;
+};
+
+// Operations run on arrays, that stay in cache, and don't depend on each
+// other, so throughput of operation is measured.
+constexpr size_t fixedOpArraySize = 1024;
+// Operations per tick.
+constexpr uint64_t fixedOpsPerTick = 1 << 16;
+
+template <typename T>
+struct Int128Ops {
+    static T mul(T a, T b) {
+        return T::fromRaw(
+            typename T::StoreType((__int128_t(a.v) * b.v) >> T::K));
+    }
+    static T div(T a, T b) {
+        return T::fromRaw(
+            typename T::StoreType((__int128_t(a.v) << T::K) / b.v));
+    }
+};
+
+template <typename T>
+struct WideOps {
+    static T mul(T a, T b) { return a * b; }
+    static T div(T a, T b) { return a / b; }
+};
+
+template <typename T, typename Ops, bool IsMul>
+FixedOpResult benchFixedOp(const BenchArgs& args, const Type& type,
+                           const std::string& intermediate) {
+    mt19937 gen(1);
+    uniform_real_distribution<double> dist(0.5, 4);
+    std::vector<T> a(fixedOpArraySize), b(fixedOpArraySize),
+        c(fixedOpArraySize);
+    for (size_t i = 0; i < fixedOpArraySize; ++i) {
+        a[i] = T(gen() % 2 ? dist(gen) : -dist(gen));
+        b[i] = T(dist(gen));
+    }
+
+    auto runRound = [&]() {
+        for (size_t i = 0; i < fixedOpArraySize; ++i) {
+            c[i] = IsMul ? Ops::mul(a[i], b[i]) : Ops::div(a[i], b[i]);
+        }
+        keepMemory(c.data());
+    };
+    // Warm up.
+    runRound();
+
+    uint64_t rounds = args.ticks * fixedOpsPerTick / fixedOpArraySize;
+    auto start = chrono::steady_clock::now();
+    for (uint64_t round = 0; round < rounds; ++round) {
+        runRound();
+    }
+    auto end = chrono::steady_clock::now();
+    return {IsMul ? "mul" : "div", type, intermediate,
+            rounds * fixedOpArraySize,
+            chrono::duration<double>(end - start).count()};
+}
+
+template <typename T>
+void benchFixedOps(const BenchArgs& args, const Type& type,
+                   std::vector<FixedOpResult>& results) {
+    results.push_back(benchFixedOp<T, WideOps<T>, true>(args, type, "wide"));
+    results.push_back(benchFixedOp<T, WideOps<T>, false>(args, type, "wide"));
+    // Saturating types clamp results, so they have no __int128 variant.
+    if constexpr (!T::Saturating) {
+        results.push_back(
+            benchFixedOp<T, Int128Ops<T>, true>(args, type, "int128"));
+        results.push_back(
+            benchFixedOp<T, Int128Ops<T>, false>(args, type, "int128"));
+    }
+}
+
+std::vector<FixedOpResult> runFixedOpBench(const BenchArgs& args) {
+    std::vector<FixedOpResult> results;
+    benchFixedOps<Fixed<16, 8>>(args, fixedType(16, 8), results);
+    benchFixedOps<Fixed<32, 16>>(args, fixedType(32, 16), results);
+    benchFixedOps<Fixed<64, 32>>(args, fixedType(64, 32), results);
+    benchFixedOps<FastFixed<32, 16>>(args, fastFixedType(32, 16), results);
+    benchFixedOps<SatFixed<16, 4>>(args, satFixedType(16, 4), results);
+    benchFixedOps<SatFixed<32, 16>>(args, satFixedType(32, 16), results);
+    for (const auto& r : results) {
+        cerr << r.op << " " << to_string(r.type) << " " << r.intermediate
+             << ": " << r.seconds * 1e9 / r.ops << " ns/op" << endl;
+    }
+    return results;
+}
+
+void writeJson(ostream& out, const BenchArgs& args,
+               const std::vector<FixedOpResult>& results) {
+    out << "{\n";
+    out << "  \"version\": 1,\n";
+    out << "  \"mode\": \"fixed-ops\",\n";
+    out << "  \"ticks\": " << args.ticks << ",\n";
+    out << "  \"results\": [";
+    for (size_t i = 0; i < results.size(); ++i) {
+        const auto& r = results[i];
+        out << (i == 0 ? "\n" : ",\n");
+        out << "    {";
+        out << "\"op\": " << quoteJson(r.op) << ", ";
+        out << "\"type\": " << quoteJson(to_string(r.type)) << ", ";
+        out << "\"intermediate\": " << quoteJson(r.intermediate) << ", ";
+        out << "\"ops\": " << r.ops << ", ";
+        out << "\"seconds\": " << r.seconds << ", ";
+        out << "\"nsPerOp\": " << r.seconds * 1e9 / r.ops;
+        out << "}";
+    }
+    out << "\n  ]\n}\n";
+}
+
+struct SaveLoadResult {
+    // "v1" is save without header, "current" is save of current version
+    std::string format;
+    // "stream" is load from istream, "mmap" is load from path
+    std::string load;
+    uint64_t bytes;
+    double saveSeconds, loadSeconds;
+    // copy of loaded state, cells of mapped file are read only by it
+    double copySeconds;
+};
+
+// Size of field, which is saved.
+constexpr size_t saveLoadHeight = 1980;
+constexpr size_t saveLoadWidth = 1000;
+// Each measure is repeated, minimal time is taken.
+constexpr unsigned saveLoadRepeats = 3;
+
+/// @brief Save without header, as it was written before versioned saves:
+/// header fields and then all fields of each cell.
+void saveStateV1(ostream& out, const FluidSimulationState& state) {
+    out.write((char*)&state.tickCount, sizeof(state.tickCount));
+
+    size_t height = state.getFieldHeight();
+    size_t width = state.getFieldWidth();
+    out.write((char*)&height, sizeof(height));
+    out.write((char*)&width, sizeof(width));
+
+    int64_t raw;
+
+    raw = int64_t(state.g.v);
+    out.write((char*)&raw, sizeof(raw));
+    out.write((char*)&state.UT, sizeof(state.UT));
+
+    for (size_t i = 0; i < rhoSize; i++) {
+        raw = int64_t(state.rho[i].v);
+        out.write((char*)&raw, sizeof(raw));
+    }
+
+    for (size_t i = 0; i < height; i++) {
+        for (size_t j = 0; j < width; j++) {
+            out.write(&state.field[i][j], sizeof(state.field[i][j]));
+
+            raw = int64_t(state.p[i][j].v);
+            out.write((char*)&raw, sizeof(raw));
+
+            out.write((char*)&state.dirs[i][j], sizeof(state.dirs[i][j]));
+            out.write((char*)&state.lastUse[i][j],
+                      sizeof(state.lastUse[i][j]));
+
+            for (const auto& velocity : state.velocity) {
+                raw = int64_t(velocity[i][j].v);
+                out.write((char*)&raw, sizeof(raw));
+            }
+        }
+    }
+}
+
+/// @brief Generated field with random p and velocities.
+FluidSimulationState makeSaveLoadState() {
+    FluidSimulationState state =
+        std::move(generateField(saveLoadHeight, saveLoadWidth).state);
+    mt19937_64 gen(1);
+    for (size_t i = 0; i < state.p.size(); ++i) {
+        state.p.data()[i] = Fixed<>::fromRaw(gen() >> 24);
+        state.lastUse.data()[i] = int(gen() % 100);
+        for (auto& velocity : state.velocity) {
+            velocity.data()[i] = Fixed<>::fromRaw(gen() >> 32);
+        }
+    }
+    state.UT = 100;
+    state.tickCount = 100;
+    return state;
+}
+
+double getSeconds(chrono::steady_clock::time_point start) {
+    return chrono::duration<double>(chrono::steady_clock::now() - start)
+        .count();
+}
+
+using SaveFunc = void (*)(ostream&, const FluidSimulationState&);
+
+SaveLoadResult benchSaveLoad(const FluidSimulationState& state,
+                             const std::string& format, SaveFunc save,
+                             bool isMapped, const std::string& path) {
+    SaveLoadResult result{format, isMapped ? "mmap" : "stream"};
+    result.saveSeconds = result.loadSeconds = result.copySeconds =
+        numeric_limits<double>::max();
+
+    for (unsigned i = 0; i < saveLoadRepeats; ++i) {
+        auto start = chrono::steady_clock::now();
+        {
+            ofstream out(path, ios::binary);
+            save(out, state);
+            if (!out) {
+                throw runtime_error("Can't write file: " + path + ".");
+            }
+        }
+        result.saveSeconds = min(result.saveSeconds, getSeconds(start));
+
+        start = chrono::steady_clock::now();
+        FluidSimulationState loaded;
+        if (isMapped) {
+            loaded = loadFluidSimulationState(path);
+        } else {
+            ifstream in(path, ios::binary);
+            loaded = loadFluidSimulationState(in);
+        }
+        result.loadSeconds = min(result.loadSeconds, getSeconds(start));
+
+        start = chrono::steady_clock::now();
+        FluidSimulationState copy = loaded;
+        result.copySeconds = min(result.copySeconds, getSeconds(start));
+
+        if (copy.p.data()[copy.p.size() - 1] !=
+            state.p.data()[state.p.size() - 1]) {
+            throw runtime_error("Loaded state differs from saved one.");
+        }
+    }
+    result.bytes = filesystem::file_size(path);
+    filesystem::remove(path);
+    return result;
+}
+
+std::vector<SaveLoadResult> runSaveLoadBench() {
+    auto state = makeSaveLoadState();
+    auto path = (filesystem::temp_directory_path() / "fluid_bench_save")
+                    .string();
+
+    std::vector<SaveLoadResult> results;
+    results.push_back(benchSaveLoad(state, "v1", saveStateV1, false, path));
+    results.push_back(benchSaveLoad(state, "current",
+                                    saveFluidSimulationState, false, path));
+    results.push_back(benchSaveLoad(state, "current",
+                                    saveFluidSimulationState, true, path));
+    for (const auto& r : results) {
+        cerr << r.format << " " << r.load << ": save " << r.saveSeconds
+             << " s, load " << r.loadSeconds << " s, copy " << r.copySeconds
+             << " s, " << r.bytes << " bytes" << endl;
+    }
+    return results;
+}
+
+void writeJson(ostream& out, const BenchArgs&,
+               const std::vector<SaveLoadResult>& results) {
+    out << "{\n";
+    out << "  \"version\": 1,\n";
+    out << "  \"mode\": \"save-load\",\n";
+    out << "  \"height\": " << saveLoadHeight << ",\n";
+    out << "  \"width\": " << saveLoadWidth << ",\n";
+    out << "  \"saveVersion\": " << SaveHeader::currentVersion << ",\n";
+    out << "  \"results\": [";
+    for (size_t i = 0; i < results.size(); ++i) {
+        const auto& r = results[i];
+        out << (i == 0 ? "\n" : ",\n");
+        out << "    {";
+        out << "\"format\": " << quoteJson(r.format) << ", ";
+        out << "\"load\": " << quoteJson(r.load) << ", ";
+        out << "\"bytes\": " << r.bytes << ", ";
+        out << "\"saveSeconds\": " << r.saveSeconds << ", ";
+        out << "\"loadSeconds\": " << r.loadSeconds << ", ";
+        out << "\"copySeconds\": " << r.copySeconds;
+        out << "}";
+    }
+    out << "\n  ]\n}\n";
+}
+
+std::vector<BenchResult> runSimulationBench(const BenchArgs& args) {
+    auto types = FluidSimulationFactory::getSupportedTypes();
+    auto fields = getFields(args);
+
+    std::vector<BenchResult> results;
+    for (const auto& field : fields) {
+        for (const auto& pType : types) {
+            for (const auto& velocityType : types) {
+                for (const auto& velocityFlowType : types) {
+                    for (unsigned threads : args.threads) {
+                        BenchResult result;
+                        try {
+                            result = runBench(args, field, pType, velocityType,
+                                              velocityFlowType, threads);
+                        } catch (const invalid_argument& e) {
+                            // Combination isn't supported by factory.
+                            cerr << field.name << " " << to_string(pType)
+                                 << " " << to_string(velocityType) << " "
+                                 << to_string(velocityFlowType)
+                                 << ": skipped, " << e.what() << endl;
+                            continue;
+                        }
+                        cerr << field.name << " " << to_string(pType) << " "
+                             << to_string(velocityType) << " "
+                             << to_string(velocityFlowType) << " x"
+                             << threads << ": "
+                             << result.ticks / result.seconds << " ticks/s"
+                             << endl;
+                        results.push_back(std::move(result));
+                    }
+                }
+            }
+        }
+    }
+    return results;
+}
+
+/// @brief Write JSON of results to output file or stdout.
+template <typename Result>
+void writeResults(const BenchArgs& args, const std::vector<Result>& results) {
+    if (args.outputFile.empty()) {
+        writeJson(cout, args, results);
+    } else {
+        ofstream out(args.outputFile);
+        writeJson(out, args, results);
+    }
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+    ios_base::sync_with_stdio(false);
+
+    BenchArgs args = parseBenchArguments(argc, argv);
+    switch (args.mode) {
+        case BenchMode::simulation:
+            writeResults(args, runSimulationBench(args));
+            break;
+        case BenchMode::kernels:
+            writeResults(args, runKernelBench(args));
+            break;
+        case BenchMode::fixedOps:
+            writeResults(args, runFixedOpBench(args));
+            break;
+        case BenchMode::saveLoad:
+            writeResults(args, runSaveLoadBench());
+            break;
+    }
+
+    return 0;
+}
@@ -14,13 +14,51 @@ constexpr struct option longOptions[] = {
     {"save",            required_argument, nullptr, 's'},
     {"save-dir",        required_argument, nullptr, 'd'},
     {"save-rate",       required_argument, nullptr, 'r'},
+    {"full-save-rate",  required_argument, nullptr, 'k'},
     {"max-iterations",  required_argument, nullptr, 'm'},
     {"threads",         required_argument, nullptr, 't'},
+    {"replay",          required_argument, nullptr, 'R'},
+    {"seek",            required_argument, nullptr, 'S'},
+    {"render",          required_argument, nullptr, 'o'},
+    {"async-render",    no_argument,       nullptr, 'A'},
+    {"frame-log",       required_argument, nullptr, 'l'},
+    {"profile-rate",    required_argument, nullptr, 'P'},
+    {"batch",           no_argument,       nullptr, 'b'},
+    {"time-limit",      required_argument, nullptr, 'T'},
+    {"max-steps",       required_argument, nullptr, 'x'},
+    {"jobs",            required_argument, nullptr, 'J'},
+    {"auto-types",      no_argument,       nullptr, 'u'},
+    {"tune-steps",      required_argument, nullptr, 'n'},
+    {"tolerance",       required_argument, nullptr, 'e'},
+    {"tune-cache",      required_argument, nullptr, 'c'},
+    {"seed",            required_argument, nullptr, 'z'},
+    {"flow-solver",     required_argument, nullptr, 'a'},
     {nullptr, 0, nullptr, 0}
 };
 // clang-format on
 
-const char* shortOptions = "i:p:v:f:s:d:r:m:t:q";
+const char* shortOptions =
+    "i:p:v:f:s:d:r:k:m:t:a:R:S:o:Al:P:bT:x:J:un:e:c:z:q";
+
+FlowSolver parseFlowSolver(const string& str) {
+    if (str == "recursive") {
+        return FlowSolver::recursive;
+    } else if (str == "iterative") {
+        return FlowSolver::iterative;
+    } else if (str == "parallel") {
+        return FlowSolver::parallel;
+    }
+    throw invalid_argument("Unknown flow solver.");
+}
+
+RenderMode parseRenderMode(const string& str) {
+    if (str == "full") {
+        return RenderMode::full;
+    } else if (str == "diff") {
+        return RenderMode::diff;
+    }
+    throw invalid_argument("Unknown render mode.");
+}
 
 ConsoleArgs parseConsoleArguments(int argc, char* argv[]) {
     ConsoleArgs args;
@@ -43,10 +81,14 @@ ConsoleArgs parseConsoleArguments(int argc, char* argv[]) {
                 break;
             case 'd':
                 args.saveDir = optarg;
+                args.hasSaveDir = true;
                 break;
             case 'r':
                 args.saveRate = std::stoul(optarg);
                 break;
+            case 'k':
+                args.fullSaveRate = std::stoul(optarg);
+                break;
             case 's':
                 args.saveFile = optarg;
                 break;
@@ -59,6 +101,54 @@ ConsoleArgs parseConsoleArguments(int argc, char* argv[]) {
             case 't':
                 args.threads = std::stoul(optarg);
                 break;
+            case 'a':
+                args.flowSolver = parseFlowSolver(optarg);
+                break;
+            case 'R':
+                args.replayPath = optarg;
+                break;
+            case 'S':
+                args.seekTick = std::stoul(optarg);
+                break;
+            case 'o':
+                args.renderMode = parseRenderMode(optarg);
+                break;
+            case 'A':
+                args.asyncRender = true;
+                break;
+            case 'l':
+                args.frameLog = optarg;
+                break;
+            case 'P':
+                args.profileRate = std::stoul(optarg);
+                break;
+            case 'b':
+                args.batch = true;
+                break;
+            case 'T':
+                args.timeLimit = std::stod(optarg);
+                break;
+            case 'x':
+                args.maxSteps = std::stoull(optarg);
+                break;
+            case 'J':
+                args.jobsFile = optarg;
+                break;
+            case 'u':
+                args.autoTypes = true;
+                break;
+            case 'n':
+                args.tuneSteps = std::stoul(optarg);
+                break;
+            case 'e':
+                args.tuneTolerance = std::stod(optarg);
+                break;
+            case 'c':
+                args.tuneCache = optarg;
+                break;
+            case 'z':
+                args.seed = std::stoull(optarg);
+                break;
             case -1:
             default:
                 throw invalid_argument("Invalid option");
@@ -69,6 +159,30 @@ ConsoleArgs parseConsoleArguments(int argc, char* argv[]) {
 }
 
 pair<bool, string> ConsoleArgs::validate() {
+    if (!jobsFile.empty()) {
+        if (!inputFile.empty() || !saveFile.empty() || !replayPath.empty()) {
+            return {false,
+                    "--jobs option cannot be used with --file, --use-save "
+                    "or --replay options."};
+        }
+        if (threads == 0) {
+            return {false, "--threads option must be greater than 0."};
+        }
+        if (autoTypes) {
+            return {false,
+                    "--auto-types option cannot be used with --jobs "
+                    "option."};
+        }
+        return {true, ""};
+    }
+    if (!replayPath.empty()) {
+        if (!inputFile.empty() || !saveFile.empty()) {
+            return {false,
+                    "--replay option cannot be used with --file or "
+                    "--use-save options."};
+        }
+        return {true, ""};
+    }
     if (!inputFile.empty() && !saveFile.empty()) {
         return {false,
                 "Both --file and --use-save options cannot be provided."};
@@ -79,9 +193,21 @@ pair<bool, string> ConsoleArgs::validate() {
     if (saveRate == 0) {
         return {false, "--save-rate option must be greater than 0."};
     }
+    if (fullSaveRate == 0) {
+        return {false, "--full-save-rate option must be greater than 0."};
+    }
+    if (timeLimit < 0) {
+        return {false, "--time-limit option must not be negative."};
+    }
     if (threads == 0) {
         return {false, "--threads option must be greater than 0."};
     }
+    if (tuneSteps == 0) {
+        return {false, "--tune-steps option must be greater than 0."};
+    }
+    if (tuneTolerance < 0 || tuneTolerance > 1) {
+        return {false, "--tolerance option must be in [0, 1]."};
+    }
 
     return {true, ""};
 }
\ No newline at end of file
@@ -0,0 +1,36 @@
+#include <cli/job_parser.hpp>
+#include <cli/type_parser.hpp>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+
+using namespace std;
+
+vector<SimulationJob> parseSimulationJobs(istream& in) {
+    vector<SimulationJob> jobs;
+
+    string line;
+    for (size_t lineNumber = 1; getline(in, line); ++lineNumber) {
+        istringstream fields(line);
+        string inputFile, pType, velocityType, velocityFlowType;
+        if (!(fields >> inputFile) || inputFile[0] == '#') {
+            continue;
+        }
+
+        SimulationJob job;
+        job.inputFile = inputFile;
+        string rest;
+        if (!(fields >> pType >> velocityType >> velocityFlowType >>
+              job.ticks) ||
+            fields >> rest) {
+            throw invalid_argument("Invalid job at line " +
+                                   to_string(lineNumber) + ".");
+        }
+        job.pType = parseType(pType);
+        job.velocityType = parseType(velocityType);
+        job.velocityFlowType = parseType(velocityFlowType);
+        jobs.push_back(std::move(job));
+    }
+
+    return jobs;
+}
@@ -1,5 +1,7 @@
 #include <cli/type_parser.hpp>
 #include <regex>
+#include <stdexcept>
+#include <utility>
 
 using namespace std;
 
@@ -7,9 +9,12 @@ const regex patterns[] = {
     regex(R"((DOUBLE))", regex_constants::icase),
     regex(R"((FLOAT))", regex_constants::icase),
     regex(R"((FAST_FIXED)\((\d+),\s*(\d+)\))", regex_constants::icase),
+    regex(R"((SAT_FIXED)\((\d+),\s*(\d+)\))", regex_constants::icase),
     regex(R"((FIXED)\((\d+),\s*(\d+)\))", regex_constants::icase),
 };
 
+const regex mixedPattern(R"(MIXED\((.*)\))", regex_constants::icase);
+
 smatch getMatch(const string& str) {
     smatch match;
     for (const auto& pattern : patterns) {
@@ -26,8 +31,54 @@ inline void toLower(std::string& str) {
     }
 }
 
+string trim(const string& str) {
+    size_t begin = str.find_first_not_of(" \t");
+    if (begin == string::npos) {
+        return "";
+    }
+    return str.substr(begin, str.find_last_not_of(" \t") - begin + 1);
+}
+
+/// @brief Split "store, accumulator" at comma outside of brackets.
+pair<string, string> splitMixedArgs(const string& args) {
+    int depth = 0;
+    for (size_t i = 0; i < args.size(); ++i) {
+        if (args[i] == '(') {
+            depth++;
+        } else if (args[i] == ')') {
+            depth--;
+        } else if (args[i] == ',' && depth == 0) {
+            return {trim(args.substr(0, i)), trim(args.substr(i + 1))};
+        }
+    }
+    throw std::invalid_argument("Invalid type.");
+}
+
+bool isFloating(const Type& type) {
+    return type.typeId == TypeId::doubleType ||
+           type.typeId == TypeId::floatType;
+}
+
+Type parseMixedType(const string& args) {
+    auto [storeArg, accumulatorArg] = splitMixedArgs(args);
+    Type store = parseType(storeArg);
+    Type accumulator = parseType(accumulatorArg);
+    if (store.isMixed() || accumulator.isMixed()) {
+        throw std::invalid_argument("Mixed type can't contain mixed type.");
+    }
+    if (isFloating(store) != isFloating(accumulator)) {
+        throw std::invalid_argument(
+            "Mixed type can't mix floating and fixed types.");
+    }
+    return mixedType(store, accumulator);
+}
+
 Type parseType(string str) {
-    smatch match = getMatch(str);
+    smatch match;
+    if (regex_match(str, match, mixedPattern)) {
+        return parseMixedType(match[1].str());
+    }
+    match = getMatch(str);
 
     string typeName = match[1].str();
     toLower(typeName);
@@ -40,6 +91,8 @@ Type parseType(string str) {
         return fixedType(stoi(match[2]), stoi(match[3]));
     } else if (typeName == "fast_fixed") {
         return fastFixedType(stoi(match[2]), stoi(match[3]));
+    } else if (typeName == "sat_fixed") {
+        return satFixedType(stoi(match[2]), stoi(match[3]));
     }
     throw std::invalid_argument("Unknown type name.");
 }
\ No newline at end of file
@@ -1,6 +1,14 @@
+#include <algorithm>
+#include <chrono>
 #include <cli/console_args.hpp>
 #include <iostream>
+#include <memory>
+#include <optional>
+#include <render/field_renderer.hpp>
+#include <render/frame_log.hpp>
+#include <simulation/checkpoint.hpp>
 #include <simulation/factory.hpp>
+#include <simulation/profile.hpp>
 
 #include "utils/utils.hpp"
 
@@ -17,41 +25,158 @@ int main(int argc, char* argv[]) {
         return 0;
     }
 
+    if (!args.replayPath.empty()) {
+        replayByArgs(args);
+        return 0;
+    }
+    if (!args.jobsFile.empty()) {
+        runJobsByArgs(args);
+        return 0;
+    }
+
     FluidSimulationState state = loadStateByArgs(args);
+    if (args.autoTypes) {
+        tuneTypesByArgs(args, state);
+    }
     FactoryContext ctx = {state.getFieldHeight(),
                           state.getFieldWidth(),
                           args.pType,
                           args.velocityType,
                           args.velocityFlowType,
                           args.threads,
-                          state};
+                          args.flowSolver,
+                          std::move(state),
+                          !args.batch};
     auto simulation = FluidSimulationFactory(ctx).create();
+    // Batch run saves states only to explicitly given dir.
+    bool saves = !args.batch || args.hasSaveDir;
+    // Used only by thread of checkpoints.
+    SaveChain saveChain(args.fullSaveRate);
+    // Thread of checkpoints is started only, if states are saved.
+    optional<CheckpointWriter> checkpoints;
+    if (saves) {
+        checkpoints.emplace(
+            [&args, &saveChain](const FluidSimulationState& state) {
+                saveStateByArgs(args, saveChain, state);
+            });
+    }
 
-    cout << "\nPress anything to start." << endl;
-    cout << "Press Ctrl+C to stop." << endl;
-    getchar();
+    if (!args.batch) {
+        cout << "\nPress anything to start." << endl;
+        cout << "Press Ctrl+C to stop." << endl;
+        getchar();
+    }
 
-    cout << "Tick " << simulation->getTickCount() << endl;
-    if (!args.quiet) {
-        simulation->printField();
+    // All output goes through renderer, because it may use other thread.
+    FieldRenderer renderer(cout, args.renderMode, args.asyncRender);
+    DynamicMatrix<char> field;
+    // Fields are recorded to log instead of printing, if it's given.
+    unique_ptr<FrameLogWriter> frameLog;
+    if (!args.frameLog.empty()) {
+        frameLog = make_unique<FrameLogWriter>(args.frameLog);
     }
+    auto renderTick = [&]() {
+        if (frameLog) {
+            simulation->getField(field);
+            frameLog->write(simulation->getTickCount(), field);
+            return;
+        }
+        if (args.batch) {
+            return;
+        }
+        if (args.quiet) {
+            renderer.render(simulation->getTickCount());
+            return;
+        }
+        simulation->getField(field);
+        renderer.render(simulation->getTickCount(), field);
+    };
 
+    // Profile of whole run is kept by summary, because profile of
+    // simulation is reset by dumps.
+    BatchSummary summary;
+    unsigned startTick = simulation->getTickCount();
+    auto start = chrono::steady_clock::now();
+    auto deadline = start + chrono::duration_cast<chrono::nanoseconds>(
+                                chrono::duration<double>(args.timeLimit));
+
+    renderTick();
     while (simulation->getTickCount() < args.maxIterations) {
+        if (args.timeLimit > 0 && chrono::steady_clock::now() >= deadline) {
+            summary.stop = BatchSummary::Stop::time;
+            break;
+        }
+        if (args.batch && args.maxSteps != 0 &&
+            summary.steps >= args.maxSteps) {
+            summary.stop = BatchSummary::Stop::steps;
+            break;
+        }
+        summary.steps++;
         if (!simulation->step()) {
             continue;
         }
 
-        cout << "Tick " << simulation->getTickCount() << endl;
-        if (!args.quiet) {
-            simulation->printField();
-        }
+        renderTick();
 
-        if (simulation->getTickCount() != 0 &&
+        if (saves && simulation->getTickCount() != 0 &&
             simulation->getTickCount() % args.saveRate == 0) {
-            // Save state of simulation to bin file.
-            saveStateByArgs(args, simulation->getState());
+            // Save state of simulation to bin file in background.
+            checkpoints->save(*simulation);
+            if (!args.batch) {
+                renderer.print("Saving state to file: " +
+                               getSavePath(args, simulation->getTickCount()) +
+                               ".");
+            }
+        }
+
+        if (args.profileRate != 0 &&
+            simulation->getTickCount() % args.profileRate == 0) {
+            renderer.print(formatProfile(simulation->getProfile()));
+            summary.profile.add(simulation->getProfile());
+            simulation->resetProfile();
         }
     }
 
+    summary.seconds =
+        chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    summary.lastTick = simulation->getTickCount();
+    summary.ticks = summary.lastTick - startTick;
+    summary.profile.add(simulation->getProfile());
+
+    using Ms = chrono::duration<double, milli>;
+    CheckpointWriter::Stats stats;
+    if (checkpoints) {
+        checkpoints->flush();
+        stats = checkpoints->getStats();
+    }
+    if (stats.saves > 0) {
+        renderer.print("Saved " + to_string(stats.saves) +
+                       " states, tick loop was blocked for " +
+                       to_string(Ms(stats.snapshotTime).count()) +
+                       " ms by snapshots and " +
+                       to_string(Ms(stats.waitTime).count()) +
+                       " ms by waiting for writes.");
+    }
+
+    if (frameLog) {
+        auto logStats = frameLog->getStats();
+        renderer.print("Recorded " + to_string(logStats.frames) +
+                       " frames to " + args.frameLog + " (" +
+                       to_string(logStats.bytes) + " bytes), tick loop " +
+                       "was blocked for " +
+                       to_string(Ms(logStats.waitTime).count()) +
+                       " ms by waiting for writes.");
+    }
+
+    if (args.batch) {
+        renderer.print(formatSummary(args, summary));
+        return 0;
+    }
+
+    // Report to stderr, so stdout has only frames.
+    auto renderStats = renderer.getStats();
+    cerr << "Rendered " << renderStats.frames << " frames in "
+         << Ms(renderStats.renderTime).count() << " ms." << endl;
+
     return 0;
 }
\ No newline at end of file
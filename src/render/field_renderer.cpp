@@ -0,0 +1,210 @@
+#include <charconv>
+#include <cstring>
+#include <render/field_renderer.hpp>
+
+using namespace std;
+
+FieldRenderer::FieldRenderer(ostream& out, RenderMode mode, bool async)
+    : out(out), mode(mode), async(async) {
+    if (async) {
+        thread = std::thread([this]() { run(); });
+    }
+}
+
+FieldRenderer::~FieldRenderer() {
+    if (!async) {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        isStopped = true;
+    }
+    condition.notify_all();
+    thread.join();
+}
+
+void FieldRenderer::render(unsigned tick, const DynamicMatrix<char>& field) {
+    Frame frame = takeFrame();
+    frame.tick = tick;
+    frame.hasField = true;
+    frame.hasLine = false;
+    frame.field.assign(field);
+    push(std::move(frame));
+}
+
+void FieldRenderer::render(unsigned tick) {
+    Frame frame = takeFrame();
+    frame.tick = tick;
+    frame.hasField = false;
+    frame.hasLine = false;
+    push(std::move(frame));
+}
+
+void FieldRenderer::print(const string& line) {
+    Frame frame = takeFrame();
+    frame.hasField = false;
+    frame.hasLine = true;
+    frame.line = line;
+    push(std::move(frame));
+}
+
+void FieldRenderer::flush() {
+    std::unique_lock<std::mutex> lock(mutex);
+    condition.wait(lock, [this]() { return pending.empty() && !isBusy; });
+}
+
+FieldRenderer::Stats FieldRenderer::getStats() {
+    flush();
+    return stats;
+}
+
+FieldRenderer::Frame FieldRenderer::takeFrame() {
+    std::unique_lock<std::mutex> lock(mutex);
+    condition.wait(lock, [this]() { return pending.size() < maxPending; });
+    if (freeFrames.empty()) {
+        return Frame();
+    }
+    Frame frame = std::move(freeFrames.back());
+    freeFrames.pop_back();
+    return frame;
+}
+
+void FieldRenderer::push(Frame&& frame) {
+    if (!async) {
+        write(frame);
+        freeFrames.push_back(std::move(frame));
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        pending.push_back(std::move(frame));
+    }
+    condition.notify_all();
+}
+
+void FieldRenderer::run() {
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true) {
+        condition.wait(lock, [this]() { return !pending.empty() || isStopped; });
+        if (pending.empty()) {
+            return;
+        }
+
+        Frame frame = std::move(pending.front());
+        pending.pop_front();
+        isBusy = true;
+        lock.unlock();
+        write(frame);
+        lock.lock();
+        freeFrames.push_back(std::move(frame));
+        isBusy = false;
+        condition.notify_all();
+    }
+}
+
+void FieldRenderer::write(const Frame& frame) {
+    auto start = chrono::steady_clock::now();
+
+    buffer.clear();
+    if (frame.hasLine) {
+        buffer += frame.line;
+        buffer += '\n';
+    } else if (!frame.hasField) {
+        buffer += "Tick ";
+        appendNumber(frame.tick);
+        buffer += '\n';
+    } else if (mode == RenderMode::diff && hasPrevious &&
+               previous.getHeight() == frame.field.getHeight() &&
+               previous.getWidth() == frame.field.getWidth()) {
+        buildDiff(frame);
+    } else {
+        buildFull(frame);
+    }
+
+    out.write(buffer.data(), buffer.size());
+    out.flush();
+
+    stats.frames += !frame.hasLine;
+    stats.bytes += buffer.size();
+    stats.renderTime += chrono::steady_clock::now() - start;
+}
+
+void FieldRenderer::buildFull(const Frame& frame) {
+    const auto& field = frame.field;
+    buffer.reserve(field.getHeight() * (field.getWidth() + 1) + 64);
+
+    if (mode == RenderMode::diff) {
+        // Clear screen.
+        buffer += "\x1b[H\x1b[2J";
+    }
+    buffer += "Tick ";
+    appendNumber(frame.tick);
+    buffer += '\n';
+    for (size_t x = 0; x < field.getHeight(); ++x) {
+        buffer.append(field[x], field.getWidth());
+        buffer += '\n';
+    }
+
+    if (mode == RenderMode::diff) {
+        previous.assign(field);
+        hasPrevious = true;
+    }
+}
+
+void FieldRenderer::buildDiff(const Frame& frame) {
+    // Changed cells closer than mergeGap are printed together, because
+    // moving of cursor costs more.
+    constexpr size_t mergeGap = 8;
+
+    const auto& field = frame.field;
+    size_t height = field.getHeight(), width = field.getWidth();
+
+    moveCursor(1, 1);
+    buffer += "Tick ";
+    appendNumber(frame.tick);
+    // Clear rest of line.
+    buffer += "\x1b[K";
+
+    for (size_t x = 0; x < height; ++x) {
+        const char* row = field[x];
+        const char* previousRow = previous[x];
+        if (memcmp(row, previousRow, width) == 0) {
+            continue;
+        }
+
+        size_t y = 0;
+        while (y < width) {
+            if (row[y] == previousRow[y]) {
+                ++y;
+                continue;
+            }
+            size_t end = y + 1;
+            for (size_t z = end; z < width && z < end + mergeGap; ++z) {
+                if (row[z] != previousRow[z]) {
+                    end = z + 1;
+                }
+            }
+            // Row 1 is tick line.
+            moveCursor(x + 2, y + 1);
+            buffer.append(row + y, end - y);
+            y = end;
+        }
+    }
+    moveCursor(height + 2, 1);
+
+    previous.assign(field);
+}
+
+void FieldRenderer::appendNumber(uint64_t value) {
+    char digits[24];
+    auto [end, error] = to_chars(digits, digits + sizeof(digits), value);
+    buffer.append(digits, end);
+}
+
+void FieldRenderer::moveCursor(size_t row, size_t column) {
+    buffer += "\x1b[";
+    appendNumber(row);
+    buffer += ';';
+    appendNumber(column);
+    buffer += 'H';
+}
@@ -0,0 +1,168 @@
+#include <cstring>
+#include <render/frame_log.hpp>
+#include <simulation/difference.hpp>
+#include <stdexcept>
+
+using namespace std;
+
+FrameLogWriter::FrameLogWriter(const string& path) : out(path, ios::binary) {
+    if (!out) {
+        throw runtime_error("Can't open frame log.");
+    }
+    thread = std::thread([this]() { run(); });
+}
+
+FrameLogWriter::~FrameLogWriter() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        isStopped = true;
+    }
+    condition.notify_all();
+    thread.join();
+}
+
+void FrameLogWriter::write(unsigned tick, const DynamicMatrix<char>& field) {
+    Frame frame;
+    {
+        auto waitStart = chrono::steady_clock::now();
+        std::unique_lock<std::mutex> lock(mutex);
+        condition.wait(lock, [this]() { return pending.size() < maxPending; });
+        stats.waitTime += chrono::steady_clock::now() - waitStart;
+
+        if (error) {
+            rethrow_exception(exchange(error, nullptr));
+        }
+        if (!freeFrames.empty()) {
+            frame = std::move(freeFrames.back());
+            freeFrames.pop_back();
+        }
+    }
+
+    // Frame isn't pending, so it isn't used by background thread.
+    frame.tick = tick;
+    frame.field.assign(field);
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        pending.push_back(std::move(frame));
+    }
+    condition.notify_all();
+}
+
+void FrameLogWriter::flush() {
+    std::unique_lock<std::mutex> lock(mutex);
+    condition.wait(lock, [this]() { return pending.empty() && !isBusy; });
+    if (error) {
+        rethrow_exception(exchange(error, nullptr));
+    }
+}
+
+FrameLogWriter::Stats FrameLogWriter::getStats() {
+    flush();
+    return stats;
+}
+
+void FrameLogWriter::run() {
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true) {
+        condition.wait(lock, [this]() { return !pending.empty() || isStopped; });
+        if (pending.empty()) {
+            return;
+        }
+
+        Frame frame = std::move(pending.front());
+        pending.pop_front();
+        isBusy = true;
+        lock.unlock();
+        try {
+            writeFrame(frame);
+        } catch (...) {
+            lock.lock();
+            error = current_exception();
+            lock.unlock();
+        }
+        lock.lock();
+        freeFrames.push_back(std::move(frame));
+        isBusy = false;
+        condition.notify_all();
+    }
+}
+
+void FrameLogWriter::writeFrame(const Frame& frame) {
+    const auto& field = frame.field;
+    buffer.clear();
+
+    if (!hasHeader) {
+        FrameLogHeader header{};
+        memcpy(header.magic, FrameLogHeader::signature, sizeof(header.magic));
+        header.version = FrameLogHeader::currentVersion;
+        header.byteOrder = FrameLogHeader::byteOrderTag;
+        header.height = field.getHeight();
+        header.width = field.getWidth();
+        buffer.append((const char*)&header, sizeof(header));
+
+        previous = DynamicMatrix<char>(field.getHeight(), field.getWidth());
+        hasHeader = true;
+    } else if (field.getHeight() != previous.getHeight() ||
+               field.getWidth() != previous.getWidth()) {
+        throw invalid_argument("Frames of log must have same size.");
+    }
+
+    size_t recordOffset = buffer.size();
+    buffer.append(sizeof(FrameLogRecord), '\0');
+    encodeDifference(field.data(), previous.data(), field.size(), buffer);
+
+    FrameLogRecord record{};
+    record.tickCount = frame.tick;
+    record.size = buffer.size() - recordOffset - sizeof(record);
+    memcpy(buffer.data() + recordOffset, &record, sizeof(record));
+
+    out.write(buffer.data(), buffer.size());
+    if (!out) {
+        throw runtime_error("Can't write frame log.");
+    }
+    previous.assign(field);
+
+    stats.frames++;
+    stats.bytes += buffer.size();
+}
+
+FrameLogReader::FrameLogReader(const string& path) : in(path, ios::binary) {
+    if (!in) {
+        throw runtime_error("Can't open frame log.");
+    }
+
+    FrameLogHeader header;
+    in.read((char*)&header, sizeof(header));
+    if (!in || memcmp(header.magic, FrameLogHeader::signature,
+                      sizeof(header.magic)) != 0) {
+        throw runtime_error("Frame log is corrupted.");
+    }
+    if (header.version != FrameLogHeader::currentVersion) {
+        throw runtime_error("Unsupported frame log version.");
+    }
+    if (header.byteOrder != FrameLogHeader::byteOrderTag) {
+        throw runtime_error("Frame log has other byte order.");
+    }
+    field = DynamicMatrix<char>(header.height, header.width);
+}
+
+bool FrameLogReader::next() {
+    FrameLogRecord record;
+    in.read((char*)&record, sizeof(record));
+    if (in.gcount() == 0) {
+        return false;
+    }
+    // Difference is never much bigger than field.
+    if (!in || record.size > 2 * field.size() + 16) {
+        throw runtime_error("Frame log is corrupted.");
+    }
+
+    buffer.resize(record.size);
+    in.read(buffer.data(), buffer.size());
+    if (!in || !applyDifference(field.data(), field.size(), buffer.data(),
+                                buffer.data() + buffer.size())) {
+        throw runtime_error("Frame log is corrupted.");
+    }
+    tickCount = record.tickCount;
+    return true;
+}
@@ -0,0 +1,74 @@
+#include <simulation/checkpoint.hpp>
+
+using namespace std;
+
+CheckpointWriter::CheckpointWriter(WriteFunc write)
+    : write(std::move(write)), thread([this]() { run(); }) {}
+
+CheckpointWriter::~CheckpointWriter() {
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        waitPending(lock);
+        isStopped = true;
+    }
+    condition.notify_all();
+    thread.join();
+}
+
+void CheckpointWriter::save(const FluidSimulationInterface& simulation) {
+    auto snapshotStart = chrono::steady_clock::now();
+    // Buffer next isn't pending, so it isn't used by background thread.
+    simulation.getState(buffers[next]);
+    auto waitStart = chrono::steady_clock::now();
+    stats.snapshotTime += waitStart - snapshotStart;
+
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        waitPending(lock);
+        stats.waitTime += chrono::steady_clock::now() - waitStart;
+        stats.saves++;
+
+        if (error) {
+            rethrow_exception(exchange(error, nullptr));
+        }
+        pending = next;
+        next = 1 - next;
+    }
+    condition.notify_all();
+}
+
+void CheckpointWriter::flush() {
+    std::unique_lock<std::mutex> lock(mutex);
+    waitPending(lock);
+    if (error) {
+        rethrow_exception(exchange(error, nullptr));
+    }
+}
+
+void CheckpointWriter::waitPending(std::unique_lock<std::mutex>& lock) {
+    condition.wait(lock, [this]() { return pending == -1; });
+}
+
+void CheckpointWriter::run() {
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true) {
+        condition.wait(lock, [this]() { return pending != -1 || isStopped; });
+        if (pending == -1) {
+            return;
+        }
+
+        const FluidSimulationState& state = buffers[pending];
+        lock.unlock();
+        try {
+            write(state);
+        } catch (...) {
+            lock.lock();
+            error = current_exception();
+            lock.unlock();
+        }
+        lock.lock();
+
+        pending = -1;
+        condition.notify_all();
+    }
+}
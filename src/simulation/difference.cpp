@@ -0,0 +1,85 @@
+#include <cstring>
+#include <simulation/difference.hpp>
+
+using namespace std;
+
+void putVarint(string& out, uint64_t value) {
+    while (value >= 0x80) {
+        out.push_back(char(value | 0x80));
+        value >>= 7;
+    }
+    out.push_back(char(value));
+}
+
+bool getVarint(const char*& p, const char* end, uint64_t& value) {
+    value = 0;
+    for (unsigned shift = 0; p != end && shift < 64; shift += 7) {
+        uint8_t byte = *p++;
+        value |= uint64_t(byte & 0x7f) << shift;
+        if (!(byte & 0x80)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void encodeDifference(const char* a, const char* b, size_t size,
+                      string& out) {
+    // Shorter runs of equal bytes are kept inside of changed bytes,
+    // because new run costs more.
+    constexpr size_t minEqualRun = 4;
+
+    size_t i = 0;
+    while (i < size) {
+        size_t equalBegin = i;
+        while (i + 8 <= size && memcmp(a + i, b + i, 8) == 0) {
+            i += 8;
+        }
+        while (i < size && a[i] == b[i]) {
+            ++i;
+        }
+        size_t changedBegin = i;
+        while (i < size) {
+            if (a[i] != b[i]) {
+                ++i;
+                continue;
+            }
+            size_t j = i;
+            while (j < size && a[j] == b[j] && j - i < minEqualRun) {
+                ++j;
+            }
+            if (j - i >= minEqualRun || j == size) {
+                break;
+            }
+            i = j;
+        }
+
+        putVarint(out, changedBegin - equalBegin);
+        putVarint(out, i - changedBegin);
+        for (size_t k = changedBegin; k < i; ++k) {
+            out.push_back(a[k] ^ b[k]);
+        }
+    }
+}
+
+bool applyDifference(char* data, size_t size, const char* p,
+                     const char* end) {
+    size_t i = 0;
+    while (p != end) {
+        uint64_t equal, changed;
+        if (!getVarint(p, end, equal) || !getVarint(p, end, changed)) {
+            return false;
+        }
+        if (equal > size - i) {
+            return false;
+        }
+        i += equal;
+        if (changed > size - i || changed > size_t(end - p)) {
+            return false;
+        }
+        for (size_t k = 0; k < changed; ++k) {
+            data[i++] ^= *p++;
+        }
+    }
+    return true;
+}
@@ -0,0 +1,376 @@
+#include <algorithm>
+#include <functional>
+#include <iostream>
+#include <simulation/factory.hpp>
+#include <simulation/generic_simulation.hpp>
+#include <simulation/simulation.hpp>
+#include <stdexcept>
+#include <tuple>
+#include <type_traits>
+#include <types/fast_fixed.hpp>
+#include <types/fixed.hpp>
+#include <types/mixed.hpp>
+#include <vector>
+
+namespace factories {
+
+/*
+Layer factory architecture.
+Each factory transform one dynamic argument into static argument
+and call next factory with all earlier transformed static arguments.
+*/
+
+using Factory = std::function<std::unique_ptr<FluidSimulationInterface>(
+    const FactoryContext&)>;
+
+/// @brief Type of TYPES and HOT_TYPES, it has both Type and C++ type.
+template <typename T, TypeId Id, size_t N = 0, size_t K = 0>
+struct TypeTag {
+    using type = T;
+    static constexpr Type value = Type(Id, N, K);
+};
+
+template <typename Store, typename Accumulator>
+struct MixedTag {
+    using type = Mixed<typename Store::type, typename Accumulator::type>;
+    static constexpr Type value = mixedType(Store::value, Accumulator::value);
+};
+
+template <typename... Tags>
+struct TypeList {};
+
+#define DOUBLE TypeTag<double, TypeId::doubleType>
+#define FLOAT TypeTag<float, TypeId::floatType>
+#define FIXED(n, k) TypeTag<Fixed<n, k>, TypeId::fixedType, n, k>
+#define FAST_FIXED(n, k) \
+    TypeTag<FastFixed<n, k>, TypeId::fastFixedType, n, k>
+#define SAT_FIXED(n, k) TypeTag<SatFixed<n, k>, TypeId::satFixedType, n, k>
+#define MIXED(store, accumulator) MixedTag<store, accumulator>
+#define HOT(p, v, f) TypeList<p, v, f>
+
+using CompiledTypes = TypeList<TYPES>;
+#ifdef HOT_TYPES
+using HotTypesList = TypeList<HOT_TYPES>;
+#endif
+
+#undef DOUBLE
+#undef FLOAT
+#undef FIXED
+#undef FAST_FIXED
+#undef SAT_FIXED
+#undef MIXED
+#undef HOT
+
+template <typename... Tags>
+std::vector<Type> getTypes(TypeList<Tags...>) {
+    return {Tags::value...};
+}
+
+/// @brief Pairs of type and make(tag of type) for each type of list.
+template <typename... Tags, typename Make>
+std::vector<std::pair<Type, Factory>> makeFactories(TypeList<Tags...>,
+                                                     Make make) {
+    return {{Tags::value, make(Tags())}...};
+}
+
+/// @brief Are all types floating or all fixed? Simulation can't be
+/// instantiated with floating and fixed types together.
+template <typename T, typename... Ts>
+constexpr bool sameKind =
+    ((std::is_floating_point_v<Accumulator<T>> ==
+      std::is_floating_point_v<Accumulator<Ts>>) &&
+     ...);
+
+bool isFloating(const Type& type) {
+    return type.getAccumulator().typeId == TypeId::doubleType ||
+           type.getAccumulator().typeId == TypeId::floatType;
+}
+
+bool isSameKind(const Type& pType, const Type& velocityType,
+                const Type& velocityFlowType) {
+    return isFloating(pType) == isFloating(velocityType) &&
+           isFloating(velocityType) == isFloating(velocityFlowType);
+}
+
+/// @brief Factory of combination, that can't be instantiated.
+std::unique_ptr<FluidSimulationInterface> createMixedKinds(
+    const FactoryContext&) {
+    throw std::invalid_argument("Floating and fixed types can't be mixed.");
+}
+
+namespace StaticFieldFactory {
+template <typename PType, typename VelocityType, typename VelocityFlowType,
+          size_t Height, size_t Width>
+std::unique_ptr<FluidSimulationInterface> create(const FactoryContext& ctx) {
+    if (ctx.verbose) {
+        std::cout << "Used static field(" << Height << ", " << Width << ")"
+                  << std::endl;
+    }
+    return std::make_unique<
+        FluidSimulation<PType, VelocityType, VelocityFlowType, Height, Width>>(
+        ctx.initialState, ctx.threads, ctx.flowSolver);
+}
+}  // namespace StaticFieldFactory
+
+namespace SizeFactory {
+template <typename PType, typename VelocityType, typename VelocityFlowType>
+std::unique_ptr<FluidSimulationInterface> create(const FactoryContext& ctx) {
+#define S(height, width)                                                  \
+    std::make_tuple(                                                      \
+        height, width,                                                    \
+        StaticFieldFactory::create<PType, VelocityType, VelocityFlowType, \
+                                   height, width>)
+
+    static const std::tuple<size_t, size_t, Factory> factories[] = {SIZES};
+
+#undef S
+
+    for (const auto& [height, width, factory] : factories) {
+        if (ctx.height == height && ctx.width == width) {
+            return factory(ctx);
+        }
+    }
+
+    if (ctx.verbose) {
+        std::cout << "Used dynamic field(" << ctx.height << ", " << ctx.width
+                  << ")" << std::endl;
+    }
+    return std::make_unique<
+        FluidSimulation<PType, VelocityType, VelocityFlowType>>(
+        ctx.initialState, ctx.threads, ctx.flowSolver);
+}
+}  // namespace SizeFactory
+
+#ifdef HOT_TYPES
+
+/*
+Only combinations of HOT_TYPES are instantiated, other combinations of TYPES
+use GenericFluidSimulation.
+*/
+
+void printTypes(const FactoryContext& ctx) {
+    if (ctx.verbose) {
+        std::cout << "PType used: " << to_string(ctx.pType) << std::endl;
+        std::cout << "VType used: " << to_string(ctx.velocityType)
+                  << std::endl;
+        std::cout << "VFlowType used: " << to_string(ctx.velocityFlowType)
+                  << std::endl;
+    }
+}
+
+namespace HotTypesFactory {
+
+struct HotTypes {
+    Type pType, velocityType, velocityFlowType;
+    Factory factory;
+};
+
+template <typename P, typename V, typename F>
+HotTypes makeHotTypes(TypeList<P, V, F>) {
+    static_assert(
+        sameKind<typename P::type, typename V::type, typename F::type>,
+        "Floating and fixed types can't be mixed in HOT_TYPES.");
+    return {P::value, V::value, F::value,
+            SizeFactory::create<typename P::type, typename V::type,
+                                typename F::type>};
+}
+
+template <typename... Hot>
+std::vector<HotTypes> makeHotTypesTable(TypeList<Hot...>) {
+    return {makeHotTypes(Hot())...};
+}
+
+const HotTypes* find(const Type& pType, const Type& velocityType,
+                     const Type& velocityFlowType) {
+    static const auto hotTypes = makeHotTypesTable(HotTypesList());
+
+    for (const auto& hot : hotTypes) {
+        if (hot.pType == pType && hot.velocityType == velocityType &&
+            hot.velocityFlowType == velocityFlowType) {
+            return &hot;
+        }
+    }
+    return nullptr;
+}
+
+/// @return nullptr, if types aren't in HOT_TYPES.
+std::unique_ptr<FluidSimulationInterface> create(const FactoryContext& ctx) {
+    auto hot = find(ctx.pType, ctx.velocityType, ctx.velocityFlowType);
+    if (hot == nullptr) {
+        return nullptr;
+    }
+    printTypes(ctx);
+    return hot->factory(ctx);
+}
+
+}  // namespace HotTypesFactory
+
+namespace GenericFactory {
+std::unique_ptr<FluidSimulationInterface> create(const FactoryContext& ctx) {
+    auto types = FluidSimulationFactory::getSupportedTypes();
+    auto isSupported = [&types](const Type& type) {
+        return std::find(types.begin(), types.end(), type) != types.end();
+    };
+    if (!isSupported(ctx.pType)) {
+        throw std::invalid_argument("Unsupported p type.");
+    }
+    if (!isSupported(ctx.velocityType)) {
+        throw std::invalid_argument("Unsupported velocity type.");
+    }
+    if (!isSupported(ctx.velocityFlowType)) {
+        throw std::invalid_argument("Unsupported velocity flow type.");
+    }
+    // Such combinations can't be instantiated, generic engine doesn't
+    // support them too: floating flow may become greater than fixed
+    // velocity.
+    if (!isSameKind(ctx.pType, ctx.velocityType, ctx.velocityFlowType)) {
+        return createMixedKinds(ctx);
+    }
+    // Flow steps smaller than precision of float flow are lost, so flow
+    // search with such types stalls and results can't be checked against
+    // instantiation.
+    if (ctx.velocityType.typeId == TypeId::doubleType &&
+        ctx.velocityFlowType.typeId == TypeId::floatType) {
+        throw std::invalid_argument(
+            "Generic engine doesn't support float velocity flow with double "
+            "velocity.");
+    }
+    if (ctx.threads > 1) {
+        std::cerr << "Generic engine works in one thread, " << ctx.threads
+                  << " threads aren't used." << std::endl;
+    }
+
+    printTypes(ctx);
+    if (ctx.verbose) {
+        std::cout << "Used generic engine with dynamic field(" << ctx.height
+                  << ", " << ctx.width << ")" << std::endl;
+    }
+    return std::make_unique<GenericFluidSimulation>(
+        ctx.initialState, ctx.pType, ctx.velocityType, ctx.velocityFlowType,
+        ctx.flowSolver);
+}
+}  // namespace GenericFactory
+
+#else
+
+namespace VelocityFlowTypeFactory {
+template <typename PType, typename VelocityType>
+std::unique_ptr<FluidSimulationInterface> create(const FactoryContext& ctx) {
+    static const auto factories =
+        makeFactories(CompiledTypes(), []<typename Tag>(Tag) -> Factory {
+            if constexpr (sameKind<PType, VelocityType,
+                                     typename Tag::type>) {
+                return SizeFactory::create<PType, VelocityType,
+                                           typename Tag::type>;
+            } else {
+                return createMixedKinds;
+            }
+        });
+
+    for (const auto& [type, factory] : factories) {
+        if (ctx.velocityFlowType == type) {
+            if (ctx.verbose) {
+                std::cout << "VFlowType used: "
+                          << to_string(ctx.velocityFlowType) << std::endl;
+            }
+            return factory(ctx);
+        }
+    }
+    throw std::invalid_argument("Unsupported velocity flow type.");
+}
+}  // namespace VelocityFlowTypeFactory
+
+namespace VelocityTypeFactory {
+template <typename PType>
+std::unique_ptr<FluidSimulationInterface> create(const FactoryContext& ctx) {
+    static const auto factories =
+        makeFactories(CompiledTypes(), []<typename Tag>(Tag) -> Factory {
+            if constexpr (sameKind<PType, typename Tag::type>) {
+                return VelocityFlowTypeFactory::create<PType,
+                                                       typename Tag::type>;
+            } else {
+                return createMixedKinds;
+            }
+        });
+
+    for (const auto& [type, factory] : factories) {
+        if (ctx.velocityType == type) {
+            if (ctx.verbose) {
+                std::cout << "VType used: " << to_string(ctx.velocityType)
+                          << std::endl;
+            }
+            return factory(ctx);
+        }
+    }
+    throw std::invalid_argument("Unsupported velocity type.");
+}
+}  // namespace VelocityTypeFactory
+
+namespace PTypeFactory {
+std::unique_ptr<FluidSimulationInterface> create(const FactoryContext& ctx) {
+    static const auto factories =
+        makeFactories(CompiledTypes(), []<typename Tag>(Tag) -> Factory {
+            return VelocityTypeFactory::create<typename Tag::type>;
+        });
+
+    for (const auto& [type, factory] : factories) {
+        if (ctx.pType == type) {
+            if (ctx.verbose) {
+                std::cout << "PType used: " << to_string(ctx.pType)
+                          << std::endl;
+            }
+            return factory(ctx);
+        }
+    }
+    throw std::invalid_argument("Unsupported p type.");
+}
+}  // namespace PTypeFactory
+
+#endif
+
+}  // namespace factories
+
+std::unique_ptr<FluidSimulationInterface> FluidSimulationFactory::create()
+    const {
+#ifdef HOT_TYPES
+    if (auto simulation = factories::HotTypesFactory::create(ctx)) {
+        return simulation;
+    }
+    return factories::GenericFactory::create(ctx);
+#else
+    return factories::PTypeFactory::create(ctx);
+#endif
+}
+
+bool FluidSimulationFactory::isSpecialized(const Type& pType,
+                                           const Type& velocityType,
+                                           const Type& velocityFlowType) {
+#ifdef HOT_TYPES
+    return factories::HotTypesFactory::find(pType, velocityType,
+                                            velocityFlowType) != nullptr;
+#else
+    if (!factories::isSameKind(pType, velocityType, velocityFlowType)) {
+        return false;
+    }
+    auto types = getSupportedTypes();
+    for (const auto& type : {pType, velocityType, velocityFlowType}) {
+        if (std::find(types.begin(), types.end(), type) == types.end()) {
+            return false;
+        }
+    }
+    return true;
+#endif
+}
+
+std::vector<Type> FluidSimulationFactory::getSupportedTypes() {
+    return factories::getTypes(factories::CompiledTypes());
+}
+
+std::vector<std::pair<size_t, size_t>>
+FluidSimulationFactory::getStaticSizes() {
+#define S(height, width) std::make_pair<size_t, size_t>(height, width)
+
+    return {SIZES};
+
+#undef S
+}
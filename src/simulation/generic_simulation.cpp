@@ -0,0 +1,86 @@
+#include <simulation/generic_simulation.hpp>
+#include <simulation/simulation.hpp>
+
+using namespace std;
+
+namespace {
+
+struct PRole {};
+struct VelocityRole {};
+struct VelocityFlowRole {};
+
+using GenericSimulation =
+    FluidSimulation<RuntimeNumber<PRole>, RuntimeNumber<VelocityRole>,
+                    RuntimeNumber<VelocityFlowRole>>;
+
+}  // namespace
+
+/// @brief Sets formats of simulation until end of scope.
+class GenericFluidSimulation::FormatScope {
+public:
+    explicit FormatScope(const array<NumberFormat, 6>& formats)
+        : p(formats[0]),
+          velocity(formats[1]),
+          velocityFlow(formats[2]),
+          pAccumulator(formats[3]),
+          velocityAccumulator(formats[4]),
+          velocityFlowAccumulator(formats[5]) {}
+
+private:
+    NumberFormatScope<PRole> p;
+    NumberFormatScope<VelocityRole> velocity;
+    NumberFormatScope<VelocityFlowRole> velocityFlow;
+    NumberFormatScope<AccumulatorRole<PRole>> pAccumulator;
+    NumberFormatScope<AccumulatorRole<VelocityRole>> velocityAccumulator;
+    NumberFormatScope<AccumulatorRole<VelocityFlowRole>>
+        velocityFlowAccumulator;
+};
+
+GenericFluidSimulation::GenericFluidSimulation(
+    const FluidSimulationState& state, const Type& pType,
+    const Type& velocityType, const Type& velocityFlowType,
+    FlowSolver flowSolver)
+    : formats{NumberFormat::fromType(pType),
+              NumberFormat::fromType(velocityType),
+              NumberFormat::fromType(velocityFlowType),
+              NumberFormat::fromType(pType.getAccumulator()),
+              NumberFormat::fromType(velocityType.getAccumulator()),
+              NumberFormat::fromType(velocityFlowType.getAccumulator())} {
+    FormatScope scope(formats);
+    simulation = make_unique<GenericSimulation>(state, 0, flowSolver);
+}
+
+GenericFluidSimulation::~GenericFluidSimulation() = default;
+
+bool GenericFluidSimulation::step() {
+    FormatScope scope(formats);
+    return simulation->step();
+}
+
+unsigned GenericFluidSimulation::getTickCount() const {
+    return simulation->getTickCount();
+}
+
+StepProfile GenericFluidSimulation::getProfile() const {
+    return simulation->getProfile();
+}
+
+void GenericFluidSimulation::resetProfile() { simulation->resetProfile(); }
+
+void GenericFluidSimulation::printField(ostream& out) const {
+    simulation->printField(out);
+}
+
+void GenericFluidSimulation::getField(DynamicMatrix<char>& field) const {
+    simulation->getField(field);
+}
+
+FluidSimulationState GenericFluidSimulation::getState() const {
+    FormatScope scope(formats);
+    return simulation->getState();
+}
+
+void GenericFluidSimulation::getState(FluidSimulationState& state) const {
+    FormatScope scope(formats);
+    simulation->getState(state);
+}
@@ -0,0 +1,80 @@
+#include <algorithm>
+#include <cstdio>
+#include <simulation/profile.hpp>
+
+using namespace std;
+
+const char* to_string(Phase phase) {
+    switch (phase) {
+        case Phase::gravity:
+            return "gravity";
+        case Phase::pressure:
+            return "pressure";
+        case Phase::flow:
+            return "flow";
+        case Phase::kinetic:
+            return "kinetic";
+        case Phase::move:
+            return "move";
+        default:
+            return "unknown";
+    }
+}
+
+void FlowCounters::add(const FlowCounters& other) {
+    rounds += other.rounds;
+    calls += other.calls;
+    maxDepth = max(maxDepth, other.maxDepth);
+}
+
+chrono::nanoseconds StepProfile::getTotalTime() const {
+    chrono::nanoseconds total{0};
+    for (auto time : phaseTime) {
+        total += time;
+    }
+    return total;
+}
+
+void StepProfile::add(const StepProfile& other) {
+    for (size_t i = 0; i < phaseCount; ++i) {
+        phaseTime[i] += other.phaseTime[i];
+    }
+    ticks += other.ticks;
+    steps += other.steps;
+    flow.add(other.flow);
+    cellsMoved += other.cellsMoved;
+    syncPhases += other.syncPhases;
+    syncWaitTime += other.syncWaitTime;
+}
+
+string formatProfile(const StepProfile& profile) {
+    if (!profileEnabled) {
+        return "Profile isn't available, build with USE_PROFILE.";
+    }
+
+    using Ms = chrono::duration<double, milli>;
+    double steps = max<uint64_t>(profile.steps, 1);
+    double ticks = max<uint64_t>(profile.ticks, 1);
+    double total = max(Ms(profile.getTotalTime()).count(), 1e-9);
+
+    char buffer[192];
+    string result = "Profile of " + to_string(profile.ticks) + " ticks (" +
+                    to_string(profile.steps) + " steps):";
+    for (size_t i = 0; i < phaseCount; ++i) {
+        double time = Ms(profile.phaseTime[i]).count();
+        snprintf(buffer, sizeof(buffer), " %s %.3f ms (%.1f%%)",
+                 to_string(Phase(i)), time, time / total * 100);
+        result += buffer;
+        result += i + 1 < phaseCount ? "," : ";";
+    }
+    snprintf(buffer, sizeof(buffer),
+             " flow rounds %.1f/step, flow calls %.0f/step, max flow depth "
+             "%llu, cells moved %.1f/tick, sync wait %.3f ms in %llu "
+             "phases.",
+             profile.flow.rounds / steps, profile.flow.calls / steps,
+             (unsigned long long)profile.flow.maxDepth,
+             profile.cellsMoved / ticks, Ms(profile.syncWaitTime).count(),
+             (unsigned long long)profile.syncPhases);
+    result += buffer;
+    return result;
+}
@@ -0,0 +1,67 @@
+#include <algorithm>
+#include <filesystem>
+#include <simulation/replay.hpp>
+#include <stdexcept>
+
+using namespace std;
+
+SaveReplay::SaveReplay(const string& dir) : dir(dir) {
+    for (const auto& file : filesystem::directory_iterator(dir)) {
+        string name = file.path().filename().string();
+        if (!file.is_regular_file() || name.empty() ||
+            !all_of(name.begin(), name.end(), ::isdigit)) {
+            continue;
+        }
+        entries.push_back({unsigned(stoul(name)), getSaveInfo(file.path())});
+    }
+    if (entries.empty()) {
+        throw runtime_error("No saves in dir " + dir);
+    }
+
+    sort(entries.begin(), entries.end(), [](const Entry& a, const Entry& b) {
+        return a.tickCount < b.tickCount;
+    });
+    current = entries.size();
+}
+
+const FluidSimulationState& SaveReplay::seek(unsigned tickCount) {
+    auto it = upper_bound(
+        entries.begin(), entries.end(), tickCount,
+        [](unsigned tick, const Entry& entry) { return tick < entry.tickCount; });
+    moveTo(it == entries.begin() ? 0 : it - entries.begin() - 1);
+    return state;
+}
+
+bool SaveReplay::next() {
+    if (current + 1 >= entries.size()) {
+        return false;
+    }
+    moveTo(current + 1);
+    return true;
+}
+
+void SaveReplay::moveTo(size_t index) {
+    // Find save, from which index is reached by deltas only.
+    size_t start = index;
+    while (start != current && start > 0 && isChained(start)) {
+        --start;
+    }
+    if (start != current) {
+        state = loadFluidSimulationState(getPath(start));
+    }
+    for (size_t i = start + 1; i <= index; ++i) {
+        applyDeltaSave(state, getPath(i));
+    }
+    current = index;
+}
+
+bool SaveReplay::isChained(size_t index) const {
+    return entries[index].info.isDelta &&
+           entries[index].info.baseTickCount == entries[index - 1].tickCount;
+}
+
+string SaveReplay::getPath(size_t index) const {
+    return (filesystem::path(dir) / to_string(entries[index].tickCount))
+        .string();
+}
+
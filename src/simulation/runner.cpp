@@ -0,0 +1,66 @@
+#include <chrono>
+#include <fstream>
+#include <simulation/factory.hpp>
+#include <simulation/runner.hpp>
+#include <simulation/save_load.hpp>
+#include <stdexcept>
+
+using namespace std;
+
+SimulationRunner::SimulationRunner(unsigned threads, FlowSolver flowSolver,
+                                   uint64_t maxSteps)
+    : pool(max(threads, 1u) - 1), flowSolver(flowSolver), maxSteps(maxSteps) {}
+
+vector<SimulationJobResult> SimulationRunner::run(
+    const vector<SimulationJob>& jobs, const ResultCallback& onResult) {
+    vector<SimulationJobResult> results(jobs.size());
+    pool.parallelFor(0, jobs.size(), 1, [&](size_t i) {
+        results[i] = runJob(jobs[i]);
+        if (onResult) {
+            std::lock_guard<std::mutex> lock(mutex);
+            onResult(i, results[i]);
+        }
+    });
+    return results;
+}
+
+SimulationJobResult SimulationRunner::runJob(const SimulationJob& job) const {
+    SimulationJobResult result;
+    try {
+        ifstream in(job.inputFile);
+        if (!in) {
+            throw runtime_error("Error opening file " + job.inputFile + ".");
+        }
+        FluidSimulationState state = loadFluidSimulationStartState(in);
+
+        // Simulation runs in thread of job, so it has no threads.
+        FactoryContext ctx = {state.getFieldHeight(),
+                              state.getFieldWidth(),
+                              job.pType,
+                              job.velocityType,
+                              job.velocityFlowType,
+                              0,
+                              flowSolver,
+                              std::move(state),
+                              false};
+        auto simulation = FluidSimulationFactory(ctx).create();
+
+        auto start = chrono::steady_clock::now();
+        while (simulation->getTickCount() < job.ticks) {
+            if (maxSteps != 0 && result.steps >= maxSteps) {
+                result.truncated = true;
+                break;
+            }
+            simulation->step();
+            result.steps++;
+        }
+        result.seconds =
+            chrono::duration<double>(chrono::steady_clock::now() - start)
+                .count();
+        result.ticks = simulation->getTickCount();
+        result.profile = simulation->getProfile();
+    } catch (const exception& e) {
+        result.error = e.what();
+    }
+    return result;
+}
@@ -1,10 +1,24 @@
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
 #include <cstddef>
+#include <cstring>
+#include <filesystem>
 #include <fstream>
 #include <limits>
+#include <simulation/difference.hpp>
 #include <simulation/save_load.hpp>
+#include <stdexcept>
+#include <type_traits>
 
 using namespace std;
 
+static_assert(sizeof(Fixed<>) == sizeof(int64_t) &&
+                  is_trivially_copyable_v<Fixed<>>,
+              "Fixed<> is saved as raw int64_t");
+
 FluidSimulationState loadFluidSimulationStartState(istream& in) {
     Fixed<> g;
     in >> g;
@@ -21,7 +35,7 @@ FluidSimulationState loadFluidSimulationStartState(istream& in) {
 
     size_t height, width;
     in >> height >> width;
-    DynamicMatrix<char> field(height, vector<char>(width));
+    DynamicMatrix<char> field(height, width);
     for (size_t x = 0; x < height; ++x) {
         in.ignore(numeric_limits<streamsize>::max(), '\n');
         for (size_t y = 0; y < width; ++y) {
@@ -36,7 +50,98 @@ FluidSimulationState loadFluidSimulationStartState(istream& in) {
     return state;
 }
 
-FluidSimulationState loadFluidSimulationState(istream& in) {
+namespace {
+
+constexpr size_t alignToSave(size_t offset) {
+    return (offset + saveAlignment - 1) / saveAlignment * saveAlignment;
+}
+
+/// @brief Size of header of given version.
+size_t getHeaderSize(uint32_t version) {
+    return version == 2 ? offsetof(SaveHeader, seed) : sizeof(SaveHeader);
+}
+
+// Header of current version is read from saves of version 2 too, it ends
+// before their first plane.
+static_assert(alignToSave(offsetof(SaveHeader, seed)) >= sizeof(SaveHeader));
+
+/// @brief Size of each plane in bytes, in order of planeOffsets.
+array<size_t, SaveHeader::planeCount> getPlaneSizes(size_t height,
+                                                    size_t width) {
+    size_t cells = height * width;
+    array<size_t, SaveHeader::planeCount> sizes = {
+        cells * sizeof(char), cells * sizeof(Fixed<>), cells * sizeof(int),
+        cells * sizeof(int)};
+    for (size_t k = 0; k < deltas.size(); ++k) {
+        sizes[4 + k] = cells * sizeof(Fixed<>);
+    }
+    return sizes;
+}
+
+/// @brief Pointers to planes of state, in order of planeOffsets.
+template <typename State>
+auto getPlanes(State& state) {
+    using Byte = conditional_t<is_const_v<State>, const char, char>;
+    array<Byte*, SaveHeader::planeCount> planes = {
+        reinterpret_cast<Byte*>(state.field.data()),
+        reinterpret_cast<Byte*>(state.p.data()),
+        reinterpret_cast<Byte*>(state.dirs.data()),
+        reinterpret_cast<Byte*>(state.lastUse.data())};
+    for (size_t k = 0; k < deltas.size(); ++k) {
+        planes[4 + k] = reinterpret_cast<Byte*>(state.velocity[k].data());
+    }
+    return planes;
+}
+
+bool hasSignature(const char* magic, const char (&signature)[8]) {
+    return memcmp(magic, signature, sizeof(signature)) == 0;
+}
+
+/// @brief Check header of current or previous version.
+/// @param fileSize size of save, if it's known.
+void checkHeader(const SaveHeader& header,
+                 size_t fileSize = numeric_limits<size_t>::max()) {
+    if (header.version != SaveHeader::currentVersion && header.version != 2) {
+        throw runtime_error("Unsupported save version.");
+    }
+    if (header.byteOrder != SaveHeader::byteOrderTag) {
+        throw runtime_error("Save has other byte order.");
+    }
+
+    auto sizes = getPlaneSizes(header.height, header.width);
+    size_t end = getHeaderSize(header.version);
+    for (size_t i = 0; i < SaveHeader::planeCount; ++i) {
+        size_t offset = header.planeOffsets[i];
+        if (offset < end || offset % saveAlignment != 0 ||
+            offset + sizes[i] > fileSize) {
+            throw runtime_error("Save is corrupted.");
+        }
+        end = offset + sizes[i];
+    }
+}
+
+/// @brief Set all fields of state except planes from header.
+void setHeaderFields(FluidSimulationState& state, const SaveHeader& header) {
+    state.tickCount = header.tickCount;
+    state.UT = header.UT;
+    state.seed = header.version == 2 ? defaultSeed : header.seed;
+    state.g = Fixed<>::fromRaw(header.g);
+    for (size_t i = 0; i < rhoSize; ++i) {
+        state.rho[i] = Fixed<>::fromRaw(header.rho[i]);
+    }
+}
+
+template <typename T>
+DynamicMatrix<T> getMappedPlane(const SaveHeader& header, char* file,
+                                size_t plane,
+                                const shared_ptr<void>& mapping) {
+    return DynamicMatrix<T>(
+        header.height, header.width,
+        reinterpret_cast<T*>(file + header.planeOffsets[plane]), mapping);
+}
+
+/// @brief Load save without header.
+FluidSimulationState loadFluidSimulationStateV1(istream& in) {
     unsigned tickCount;
     size_t height, width;
 
@@ -68,9 +173,9 @@ FluidSimulationState loadFluidSimulationState(istream& in) {
             in.read((char*)&state.dirs[i][j], sizeof(state.dirs[i][j]));
             in.read((char*)&state.lastUse[i][j], sizeof(state.lastUse[i][j]));
 
-            for (auto& velocity : state.velocity[i][j]) {
+            for (auto& velocity : state.velocity) {
                 in.read((char*)&raw, sizeof(raw));
-                velocity.v = raw;
+                velocity[i][j].v = raw;
             }
         }
     }
@@ -78,39 +183,288 @@ FluidSimulationState loadFluidSimulationState(istream& in) {
     return state;
 }
 
-void saveFluidSimulationState(ostream& out, const FluidSimulationState& state) {
-    out.write((char*)&state.tickCount, sizeof(state.tickCount));
+/// @brief Copy planes of state to other state of same size.
+void copyPlanes(const FluidSimulationState& from, FluidSimulationState& to) {
+    if (from.getFieldHeight() != to.getFieldHeight() ||
+        from.getFieldWidth() != to.getFieldWidth()) {
+        to = from;
+        return;
+    }
+    auto sizes = getPlaneSizes(from.getFieldHeight(), from.getFieldWidth());
+    auto src = getPlanes(from);
+    auto dst = getPlanes(to);
+    for (size_t i = 0; i < SaveHeader::planeCount; ++i) {
+        memcpy(dst[i], src[i], sizes[i]);
+    }
+}
 
-    size_t height = state.getFieldHeight();
-    size_t width = state.getFieldWidth();
-    out.write((char*)&height, sizeof(height));
-    out.write((char*)&width, sizeof(width));
+/// @brief Stamp of every visited cell is UT after tick, so stamps of base
+/// are moved to new UT before finding difference.
+void shiftLastUse(DynamicMatrix<int>& lastUse, int baseUT, int UT) {
+    for (size_t i = 0; i < lastUse.size(); ++i) {
+        if (lastUse.data()[i] == baseUT) {
+            lastUse.data()[i] = UT;
+        }
+    }
+}
 
-    int64_t raw;
+/// @brief Read whole delta save and check its header.
+string readDeltaSave(const string& path, DeltaSaveHeader& header) {
+    ifstream in(path, ios::binary);
+    if (!in.is_open()) {
+        throw runtime_error("Error opening file " + path);
+    }
+    string data{istreambuf_iterator<char>(in), istreambuf_iterator<char>()};
 
-    raw = int64_t(state.g.v);
-    out.write((char*)&raw, sizeof(raw));
-    out.write((char*)&state.UT, sizeof(state.UT));
+    if (data.size() < sizeof(header)) {
+        throw runtime_error("Save is corrupted.");
+    }
+    memcpy(&header, data.data(), sizeof(header));
+    if (!hasSignature(header.magic, DeltaSaveHeader::signature)) {
+        throw invalid_argument("File isn't delta save.");
+    }
+    if (header.version != DeltaSaveHeader::currentVersion) {
+        throw runtime_error("Unsupported save version.");
+    }
+    if (header.byteOrder != SaveHeader::byteOrderTag) {
+        throw runtime_error("Save has other byte order.");
+    }
+    // Base is earlier tick, so chain always ends.
+    if (header.baseTickCount >= header.tickCount) {
+        throw runtime_error("Save is corrupted.");
+    }
+    return data;
+}
 
-    for (size_t i = 0; i < rhoSize; i++) {
-        raw = int64_t(state.rho[i].v);
-        out.write((char*)&raw, sizeof(raw));
+/// @brief Apply delta save to its base state.
+void applyDelta(FluidSimulationState& state, const DeltaSaveHeader& header,
+                const string& data) {
+    if (state.getFieldHeight() != header.height ||
+        state.getFieldWidth() != header.width) {
+        throw runtime_error("Save is corrupted.");
     }
+    shiftLastUse(state.lastUse, state.UT, header.UT);
+    state.tickCount = header.tickCount;
+    state.UT = header.UT;
 
-    for (size_t i = 0; i < height; i++) {
-        for (size_t j = 0; j < width; j++) {
-            out.write(&state.field[i][j], sizeof(state.field[i][j]));
+    auto sizes = getPlaneSizes(header.height, header.width);
+    auto planes = getPlanes(state);
+    const char* p = data.data() + sizeof(header);
+    const char* end = data.data() + data.size();
+    for (size_t i = 0; i < SaveHeader::planeCount; ++i) {
+        if (header.planeSizes[i] > size_t(end - p)) {
+            throw runtime_error("Save is corrupted.");
+        }
+        if (!applyDifference(planes[i], sizes[i], p,
+                             p + header.planeSizes[i])) {
+            throw runtime_error("Save is corrupted.");
+        }
+        p += header.planeSizes[i];
+    }
+}
 
-            raw = int64_t(state.p[i][j].v);
-            out.write((char*)&raw, sizeof(raw));
+FluidSimulationState loadDeltaSave(const string& path) {
+    DeltaSaveHeader header;
+    string data = readDeltaSave(path, header);
 
-            out.write((char*)&state.dirs[i][j], sizeof(state.dirs[i][j]));
-            out.write((char*)&state.lastUse[i][j], sizeof(state.lastUse[i][j]));
+    auto basePath = filesystem::path(path).parent_path() /
+                    to_string(header.baseTickCount);
+    FluidSimulationState state = loadFluidSimulationState(basePath.string());
+    applyDelta(state, header, data);
+    return state;
+}
 
-            for (const auto& velocity : state.velocity[i][j]) {
-                raw = int64_t(velocity.v);
-                out.write((char*)&raw, sizeof(raw));
-            }
+}  // namespace
+
+FluidSimulationState loadFluidSimulationState(istream& in) {
+    auto start = in.tellg();
+    SaveHeader header;
+    if (!in.read((char*)&header, sizeof(header)) ||
+        !hasSignature(header.magic, SaveHeader::signature)) {
+        if (hasSignature(header.magic, DeltaSaveHeader::signature)) {
+            throw runtime_error("Delta save can be loaded only from file.");
         }
+        in.clear();
+        in.seekg(start);
+        return loadFluidSimulationStateV1(in);
+    }
+    checkHeader(header);
+
+    FluidSimulationState state(header.height, header.width);
+    setHeaderFields(state, header);
+
+    auto sizes = getPlaneSizes(header.height, header.width);
+    auto data = getPlanes(state);
+    size_t offset = sizeof(header);
+    for (size_t i = 0; i < SaveHeader::planeCount; ++i) {
+        in.ignore(header.planeOffsets[i] - offset);
+        in.read(data[i], sizes[i]);
+        offset = header.planeOffsets[i] + sizes[i];
+    }
+    if (!in) {
+        throw runtime_error("Save is corrupted.");
+    }
+
+    return state;
+}
+
+FluidSimulationState loadFluidSimulationState(const string& path) {
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw runtime_error("Error opening file " + path);
+    }
+
+    struct stat info;
+    SaveHeader header;
+    bool hasMagic = fstat(fd, &info) == 0 &&
+                    pread(fd, header.magic, sizeof(header.magic), 0) ==
+                        sizeof(header.magic);
+    if (hasMagic && hasSignature(header.magic, DeltaSaveHeader::signature)) {
+        close(fd);
+        return loadDeltaSave(path);
+    }
+
+    bool isCurrent = hasMagic && size_t(info.st_size) >= sizeof(header) &&
+                     pread(fd, &header, sizeof(header), 0) == sizeof(header) &&
+                     hasSignature(header.magic, SaveHeader::signature);
+    if (!isCurrent) {
+        close(fd);
+        ifstream in(path, ios::binary);
+        return loadFluidSimulationState(in);
+    }
+
+    size_t size = info.st_size;
+    // Private mapping: changes of planes aren't written to file.
+    void* file =
+        mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (file == MAP_FAILED) {
+        throw runtime_error("Error mapping file " + path);
+    }
+    shared_ptr<void> mapping(file, [size](void* p) { munmap(p, size); });
+
+    checkHeader(header, size);
+
+    FluidSimulationState state;
+    setHeaderFields(state, header);
+    char* bytes = static_cast<char*>(file);
+    state.field = getMappedPlane<char>(header, bytes, 0, mapping);
+    state.p = getMappedPlane<Fixed<>>(header, bytes, 1, mapping);
+    state.dirs = getMappedPlane<int>(header, bytes, 2, mapping);
+    state.lastUse = getMappedPlane<int>(header, bytes, 3, mapping);
+    for (size_t k = 0; k < deltas.size(); ++k) {
+        state.velocity[k] =
+            getMappedPlane<Fixed<>>(header, bytes, 4 + k, mapping);
+    }
+
+    return state;
+}
+
+void saveFluidSimulationState(ostream& out, const FluidSimulationState& state) {
+    SaveHeader header{};
+    memcpy(header.magic, SaveHeader::signature, sizeof(header.magic));
+    header.version = SaveHeader::currentVersion;
+    header.byteOrder = SaveHeader::byteOrderTag;
+    header.height = state.getFieldHeight();
+    header.width = state.getFieldWidth();
+    header.tickCount = state.tickCount;
+    header.UT = state.UT;
+    header.seed = state.seed;
+    header.g = int64_t(state.g.v);
+    for (size_t i = 0; i < rhoSize; ++i) {
+        header.rho[i] = int64_t(state.rho[i].v);
     }
-}
\ No newline at end of file
+
+    auto sizes = getPlaneSizes(header.height, header.width);
+    size_t offset = sizeof(header);
+    for (size_t i = 0; i < SaveHeader::planeCount; ++i) {
+        offset = alignToSave(offset);
+        header.planeOffsets[i] = offset;
+        offset += sizes[i];
+    }
+
+    out.write((char*)&header, sizeof(header));
+
+    const char padding[saveAlignment] = {};
+    auto data = getPlanes(state);
+    offset = sizeof(header);
+    for (size_t i = 0; i < SaveHeader::planeCount; ++i) {
+        out.write(padding, header.planeOffsets[i] - offset);
+        out.write(data[i], sizes[i]);
+        offset = header.planeOffsets[i] + sizes[i];
+    }
+}
+
+void saveFluidSimulationStateDelta(ostream& out,
+                                   const FluidSimulationState& state,
+                                   const FluidSimulationState& base) {
+    DeltaSaveHeader header{};
+    memcpy(header.magic, DeltaSaveHeader::signature, sizeof(header.magic));
+    header.version = DeltaSaveHeader::currentVersion;
+    header.byteOrder = SaveHeader::byteOrderTag;
+    header.height = state.getFieldHeight();
+    header.width = state.getFieldWidth();
+    header.tickCount = state.tickCount;
+    header.UT = state.UT;
+    header.baseTickCount = base.tickCount;
+    if (base.getFieldHeight() != header.height ||
+        base.getFieldWidth() != header.width) {
+        throw invalid_argument("Base of delta save has other size.");
+    }
+
+    DynamicMatrix<int> baseLastUse = base.lastUse;
+    shiftLastUse(baseLastUse, base.UT, state.UT);
+
+    auto sizes = getPlaneSizes(header.height, header.width);
+    auto planes = getPlanes(state);
+    auto basePlanes = getPlanes(base);
+    basePlanes[3] = reinterpret_cast<const char*>(baseLastUse.data());
+    array<string, SaveHeader::planeCount> differences;
+    for (size_t i = 0; i < SaveHeader::planeCount; ++i) {
+        encodeDifference(planes[i], basePlanes[i], sizes[i], differences[i]);
+        header.planeSizes[i] = differences[i].size();
+    }
+
+    out.write((char*)&header, sizeof(header));
+    for (const auto& difference : differences) {
+        out.write(difference.data(), difference.size());
+    }
+}
+
+void SaveChain::save(ostream& out, const FluidSimulationState& state) {
+    bool isFull = saves % fullSaveRate == 0;
+    if (isFull) {
+        saveFluidSimulationState(out, state);
+    } else {
+        saveFluidSimulationStateDelta(out, state, previous);
+    }
+    saves++;
+
+    if (fullSaveRate > 1) {
+        copyPlanes(state, previous);
+        previous.tickCount = state.tickCount;
+        previous.UT = state.UT;
+    }
+}
+
+SaveInfo getSaveInfo(const string& path) {
+    ifstream in(path, ios::binary);
+    if (!in.is_open()) {
+        throw runtime_error("Error opening file " + path);
+    }
+    DeltaSaveHeader header;
+    if (in.read((char*)&header, sizeof(header)) &&
+        hasSignature(header.magic, DeltaSaveHeader::signature)) {
+        return {true, header.baseTickCount};
+    }
+    return {false, 0};
+}
+
+void applyDeltaSave(FluidSimulationState& state, const string& path) {
+    DeltaSaveHeader header;
+    string data = readDeltaSave(path, header);
+    if (state.tickCount != header.baseTickCount) {
+        throw invalid_argument("State isn't base of delta save.");
+    }
+    applyDelta(state, header, data);
+}
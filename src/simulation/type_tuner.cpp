@@ -0,0 +1,322 @@
+#include <poll.h>
+#include <signal.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <cstring>
+#include <simulation/factory.hpp>
+#include <simulation/generic_simulation.hpp>
+#include <simulation/type_tuner.hpp>
+#include <stdexcept>
+
+using namespace std;
+
+namespace {
+
+/// @brief Message of child process, it's followed by size bytes of field
+/// or error message.
+struct RunHeader {
+    uint32_t isFailed;
+    uint32_t ticks;
+    double seconds;
+    uint64_t size;
+};
+
+struct RunOutput {
+    TuneCandidate candidate;
+    DynamicMatrix<char> field;
+};
+
+unique_ptr<FluidSimulationInterface> createSimulation(
+    const FluidSimulationState& state, const TypeCombination& types,
+    const TuneOptions& options, bool isReference) {
+    FactoryContext ctx = {state.getFieldHeight(),
+                          state.getFieldWidth(),
+                          types.pType,
+                          types.velocityType,
+                          types.velocityFlowType,
+                          options.threads,
+                          options.flowSolver,
+                          state,
+                          false};
+    try {
+        return FluidSimulationFactory(ctx).create();
+    } catch (const invalid_argument&) {
+        if (!isReference) {
+            throw;
+        }
+        // Reference is needed even if its types aren't compiled in.
+        return make_unique<GenericFluidSimulation>(
+            state, types.pType, types.velocityType, types.velocityFlowType,
+            options.flowSolver);
+    }
+}
+
+void writeAll(int fd, const char* data, size_t size) {
+    while (size > 0) {
+        ssize_t written = write(fd, data, size);
+        if (written <= 0) {
+            return;
+        }
+        data += written;
+        size -= written;
+    }
+}
+
+/// @brief Body of child process.
+void run(int fd, const FluidSimulationState& state,
+         const TypeCombination& types, const TuneOptions& options,
+         bool isReference) {
+    RunHeader header{};
+    string payload;
+    try {
+        auto simulation = createSimulation(state, types, options, isReference);
+        unsigned startTick = simulation->getTickCount();
+        auto start = chrono::steady_clock::now();
+        for (unsigned i = 0; i < options.steps; ++i) {
+            simulation->step();
+        }
+        header.seconds =
+            chrono::duration<double>(chrono::steady_clock::now() - start)
+                .count();
+        header.ticks = simulation->getTickCount() - startTick;
+
+        DynamicMatrix<char> field;
+        simulation->getField(field);
+        payload.assign(field.data(), field.size());
+    } catch (const exception& e) {
+        header.isFailed = 1;
+        payload = e.what();
+    }
+    header.size = payload.size();
+    writeAll(fd, (const char*)&header, sizeof(header));
+    writeAll(fd, payload.data(), payload.size());
+}
+
+/// @brief Read size bytes until deadline.
+/// @return false, if pipe is closed or deadline is reached.
+bool readAll(int fd, char* data, size_t size,
+             chrono::steady_clock::time_point deadline) {
+    while (size > 0) {
+        auto left = chrono::duration_cast<chrono::milliseconds>(
+            deadline - chrono::steady_clock::now());
+        if (left.count() <= 0) {
+            return false;
+        }
+        pollfd request = {fd, POLLIN, 0};
+        if (poll(&request, 1, left.count()) <= 0) {
+            continue;
+        }
+        ssize_t count = read(fd, data, size);
+        if (count <= 0) {
+            return false;
+        }
+        data += count;
+        size -= count;
+    }
+    return true;
+}
+
+/// @brief Run types on state in child process.
+RunOutput runInChild(const FluidSimulationState& state,
+                     const TypeCombination& types, const TuneOptions& options,
+                     bool isReference) {
+    RunOutput output;
+    output.candidate.types = types;
+
+    int fds[2];
+    if (pipe(fds) != 0) {
+        throw runtime_error("Can't create pipe for tuning.");
+    }
+    pid_t pid = fork();
+    if (pid < 0) {
+        close(fds[0]);
+        close(fds[1]);
+        throw runtime_error("Can't create process for tuning.");
+    }
+    if (pid == 0) {
+        close(fds[0]);
+        run(fds[1], state, types, options, isReference);
+        // Child mustn't run destructors of parent's objects.
+        _exit(0);
+    }
+    close(fds[1]);
+
+    auto deadline =
+        chrono::steady_clock::now() +
+        chrono::duration_cast<chrono::nanoseconds>(
+            chrono::duration<double>(options.timeLimit));
+    RunHeader header;
+    bool isRead = readAll(fds[0], (char*)&header, sizeof(header), deadline);
+    string payload;
+    if (isRead) {
+        payload.resize(header.size);
+        isRead = readAll(fds[0], payload.data(), payload.size(), deadline);
+    }
+    close(fds[0]);
+
+    bool isTimeOut = !isRead && chrono::steady_clock::now() >= deadline;
+    if (isTimeOut) {
+        kill(pid, SIGKILL);
+    }
+    int status = 0;
+    waitpid(pid, &status, 0);
+
+    auto& candidate = output.candidate;
+    if (isTimeOut) {
+        candidate.error = "time limit is exceeded";
+    } else if (!isRead) {
+        candidate.error =
+            WIFSIGNALED(status)
+                ? "killed by signal " + to_string(WTERMSIG(status))
+                : "run is failed";
+    } else if (header.isFailed) {
+        candidate.error = payload;
+    } else if (payload.size() != state.field.size()) {
+        candidate.error = "field has other size";
+    } else {
+        candidate.ticks = header.ticks;
+        candidate.seconds = header.seconds;
+        output.field = DynamicMatrix<char>(state.getFieldHeight(),
+                                           state.getFieldWidth());
+        memcpy(output.field.data(), payload.data(), payload.size());
+    }
+    return output;
+}
+
+/// @brief Share of cells (except walls), which differ in fields.
+double getDivergence(const DynamicMatrix<char>& initial,
+                     const DynamicMatrix<char>& reference,
+                     const DynamicMatrix<char>& field) {
+    size_t cells = 0, differ = 0;
+    for (size_t i = 0; i < initial.size(); ++i) {
+        if (initial.data()[i] != '#') {
+            cells++;
+            differ += reference.data()[i] != field.data()[i];
+        }
+    }
+    return cells > 0 ? double(differ) / cells : 0;
+}
+
+class Hash {
+public:
+    void add(const void* data, size_t size) {
+        auto bytes = (const unsigned char*)data;
+        for (size_t i = 0; i < size; ++i) {
+            value = (value ^ bytes[i]) * 1099511628211ull;
+        }
+    }
+
+    template <typename T>
+    void add(const T& x) {
+        add(&x, sizeof(x));
+    }
+
+    void add(const Type& type) {
+        // Type has padding, so fields are added separately.
+        add(type.typeId);
+        add(type.n);
+        add(type.k);
+        add(type.accumulatorId);
+        add(type.accumulatorN);
+        add(type.accumulatorK);
+    }
+
+    uint64_t get() const { return value; }
+
+private:
+    // FNV-1a
+    uint64_t value = 14695981039346656037ull;
+};
+
+}  // namespace
+
+double TuneCandidate::getTicksPerSecond() const {
+    return seconds > 0 ? ticks / seconds : 0;
+}
+
+TypeCombination getReferenceTypes() {
+    return {fixedType(64, 32), fixedType(64, 32), fixedType(64, 32)};
+}
+
+TuneResult tuneTypes(const FluidSimulationState& state,
+                     const TuneOptions& options) {
+    auto reference = runInChild(state, getReferenceTypes(), options, true);
+    if (!reference.candidate.error.empty()) {
+        throw runtime_error("Reference run is failed: " +
+                            reference.candidate.error + ".");
+    }
+
+    TuneResult result;
+    const TuneCandidate* best = nullptr;
+    auto types = FluidSimulationFactory::getSupportedTypes();
+    for (const auto& pType : types) {
+        for (const auto& velocityType : types) {
+            for (const auto& velocityFlowType : types) {
+                auto output = runInChild(
+                    state, {pType, velocityType, velocityFlowType}, options,
+                    false);
+                if (output.candidate.error.empty()) {
+                    output.candidate.divergence = getDivergence(
+                        state.field, reference.field, output.field);
+                }
+                result.candidates.push_back(std::move(output.candidate));
+            }
+        }
+    }
+
+    for (const auto& candidate : result.candidates) {
+        if (!candidate.error.empty() ||
+            candidate.divergence > options.tolerance) {
+            continue;
+        }
+        if (best == nullptr ||
+            candidate.getTicksPerSecond() > best->getTicksPerSecond()) {
+            best = &candidate;
+        }
+    }
+    if (best == nullptr) {
+        throw runtime_error("No combination of types is accurate enough.");
+    }
+    result.best = best->types;
+    return result;
+}
+
+uint64_t getTuneKey(const FluidSimulationState& state,
+                    const TuneOptions& options) {
+    Hash hash;
+    hash.add(state.getFieldHeight());
+    hash.add(state.getFieldWidth());
+    hash.add(state.field.data(), state.field.size());
+    hash.add(state.p.data(), state.p.size() * sizeof(Fixed<>));
+    for (const auto& plane : state.velocity) {
+        hash.add(plane.data(), plane.size() * sizeof(Fixed<>));
+    }
+    hash.add(state.lastUse.data(), state.lastUse.size() * sizeof(int));
+    hash.add(state.g);
+    hash.add(state.rho);
+    hash.add(state.UT);
+    hash.add(state.tickCount);
+    hash.add(state.seed);
+
+    hash.add(options.steps);
+    hash.add(options.tolerance);
+    hash.add(options.threads);
+    hash.add(options.flowSolver);
+
+    // Speed of combination depends on its specialization.
+    auto types = FluidSimulationFactory::getSupportedTypes();
+    for (const auto& pType : types) {
+        for (const auto& velocityType : types) {
+            for (const auto& velocityFlowType : types) {
+                hash.add(pType);
+                hash.add(velocityType);
+                hash.add(velocityFlowType);
+                hash.add(FluidSimulationFactory::isSpecialized(
+                    pType, velocityType, velocityFlowType));
+            }
+        }
+    }
+    return hash.get();
+}
@@ -0,0 +1,33 @@
+#include <thread/task.hpp>
+
+void Task::release() {
+    if (refs.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+        allocator->free(this);
+    }
+}
+
+Task* TaskAllocator::allocate() {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    Task* task;
+    if (freeTasks.empty()) {
+        tasks.push_back(std::unique_ptr<Task>(new Task()));
+        // Free list can't grow later.
+        freeTasks.reserve(tasks.capacity());
+        task = tasks.back().get();
+        task->allocator = this;
+    } else {
+        task = freeTasks.back();
+        freeTasks.pop_back();
+    }
+
+    task->refs = 1;
+    return task;
+}
+
+void TaskAllocator::free(Task* task) {
+    task->reset();
+
+    std::lock_guard<std::mutex> lock(mutex);
+    freeTasks.push_back(task);
+}
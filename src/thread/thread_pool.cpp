@@ -6,36 +6,111 @@ void ThreadPool::stop() {
     }
 
     isStopped = true;
-    taskAddCondition.notify_all();
+    for (auto& worker : workers) {
+        worker->wakeEpoch++;
+        worker->wakeEpoch.notify_all();
+    }
     for (auto& thread : threads) {
         thread.join();
     }
 }
 
 void ThreadPool::waitAll() {
-    std::unique_lock<std::mutex> lock(tasksMutex);
-    taskCompleteCondition.wait(
-        lock, [this]() { return activeTasks == 0 && tasks.empty(); });
+    for (unsigned active = activeTasks.load(); active != 0;
+         active = activeTasks.load()) {
+        activeTasks.wait(active);
+    }
 }
 
-void ThreadPool::run() {
-    while (true) {
-        std::unique_lock<std::mutex> lock(tasksMutex);
-        taskAddCondition.wait(lock,
-                              [this]() { return !tasks.empty() || isStopped; });
-        if (isStopped) {
+void ThreadPool::pushTask(Task* task) {
+    // pool without threads runs tasks on calling thread
+    if (poolSize == 0) {
+        task->run();
+        task->release();
+        return;
+    }
+
+    activeTasks++;
+
+    unsigned index = nextWorker++ % poolSize;
+    Worker& worker = *workers[index];
+    {
+        std::lock_guard<std::mutex> lock(worker.mutex);
+        worker.tasks.pushBack(task);
+    }
+
+    queuedTasks++;
+    if (parkedThreads > 0) {
+        wakeOne(index);
+    }
+}
+
+void ThreadPool::wakeOne(unsigned index) {
+    for (unsigned i = 0; i < poolSize; ++i) {
+        Worker& worker = *workers[(index + i) % poolSize];
+        bool parked = true;
+        if (worker.parked.compare_exchange_strong(parked, false)) {
+            worker.wakeEpoch++;
+            worker.wakeEpoch.notify_one();
             return;
         }
+    }
+}
 
-        auto task = std::move(tasks.front());
-        tasks.pop();
-        activeTasks++;
-        lock.unlock();
+Task* ThreadPool::popTask(unsigned index) {
+    {
+        Worker& worker = *workers[index];
+        std::lock_guard<std::mutex> lock(worker.mutex);
+        if (!worker.tasks.empty()) {
+            queuedTasks--;
+            return worker.tasks.popBack();
+        }
+    }
+
+    for (unsigned i = 1; i < poolSize; ++i) {
+        Worker& victim = *workers[(index + i) % poolSize];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        if (!victim.tasks.empty()) {
+            queuedTasks--;
+            return victim.tasks.popFront();
+        }
+    }
+
+    return nullptr;
+}
+
+void ThreadPool::park(unsigned index) {
+    Worker& worker = *workers[index];
+    unsigned epoch = worker.wakeEpoch;
+    worker.parked = true;
+    parkedThreads++;
+    // pushTask increments queuedTasks before checking parkedThreads,
+    // so either task is seen here or wakeEpoch is changed.
+    if (queuedTasks <= 0 && !isStopped) {
+        worker.wakeEpoch.wait(epoch);
+    }
+    worker.parked = false;
+    parkedThreads--;
+}
+
+void ThreadPool::run(unsigned index) {
+    while (true) {
+        Task* task = popTask(index);
+        if (!task) {
+            if (!spinUntil([this]() { return queuedTasks > 0 || isStopped; })) {
+                park(index);
+            }
+            if (isStopped) {
+                return;
+            }
+            continue;
+        }
 
         task->run();
+        task->release();
 
-        lock.lock();
-        activeTasks--;
-        taskCompleteCondition.notify_one();
+        if (activeTasks.fetch_sub(1) == 1) {
+            activeTasks.notify_all();
+        }
     }
 }
@@ -0,0 +1,53 @@
+#include <cstdint>
+#include <stdexcept>
+#include <types/runtime_number.hpp>
+
+using namespace std;
+
+namespace {
+
+/// @brief Bits of store type of FastFixed<n, k>, 0 if there is no such type.
+size_t getFastStoreBits(size_t n) {
+    if (n > 64) {
+        return 0;
+    }
+    if (n > 32) {
+        return sizeof(int_fast64_t) * 8;
+    }
+    if (n > 16) {
+        return sizeof(int_fast32_t) * 8;
+    }
+    if (n > 8) {
+        return sizeof(int_fast16_t) * 8;
+    }
+    return sizeof(int_fast8_t) * 8;
+}
+
+}  // namespace
+
+NumberFormat NumberFormat::fromType(const Type& type) {
+    size_t n = 0;
+    bool saturating = false;
+    switch (type.typeId) {
+        case TypeId::doubleType:
+            return {Kind::doubleKind};
+        case TypeId::floatType:
+            return {Kind::floatKind};
+        case TypeId::satFixedType:
+            saturating = true;
+            [[fallthrough]];
+        case TypeId::fixedType:
+            if (type.n == 8 || type.n == 16 || type.n == 32 || type.n == 64) {
+                n = type.n;
+            }
+            break;
+        case TypeId::fastFixedType:
+            n = getFastStoreBits(type.n);
+            break;
+    }
+    // Same limit of k as BaseFixed has.
+    if (n == 0 || type.k > n) {
+        throw invalid_argument("Unsupported type: " + to_string(type) + ".");
+    }
+    return fixed(n, type.k, saturating);
+}
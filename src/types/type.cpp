@@ -3,6 +3,10 @@
 using namespace std;
 
 string to_string(const Type& type) {
+    if (type.isMixed()) {
+        return "mixed(" + to_string(type.getStore()) + "," +
+               to_string(type.getAccumulator()) + ")";
+    }
     switch (type.typeId) {
         case TypeId::doubleType:
             return "double";
@@ -13,6 +17,9 @@ string to_string(const Type& type) {
         case TypeId::fastFixedType:
             return "fast_fixed(" + to_string(type.n) + "," + to_string(type.k) +
                    ")";
+        case TypeId::satFixedType:
+            return "sat_fixed(" + to_string(type.n) + "," + to_string(type.k) +
+                   ")";
         default:
             return "Unknown";
     }
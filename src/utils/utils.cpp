@@ -1,7 +1,17 @@
 #include "utils.hpp"
 
+#include <algorithm>
+#include <chrono>
+#include <cli/job_parser.hpp>
+#include <filesystem>
 #include <fstream>
+#include <sstream>
+#include <render/frame_log.hpp>
+#include <simulation/factory.hpp>
+#include <simulation/replay.hpp>
+#include <simulation/runner.hpp>
 #include <simulation/save_load.hpp>
+#include <simulation/type_tuner.hpp>
 
 using namespace std;
 
@@ -19,27 +29,238 @@ FluidSimulationState loadStateByArgs(const ConsoleArgs& args) {
         cout << "Successfully loaded start state of simulation." << endl;
     } else {
         // Load saved state of simulation from bin file.
-        ifstream in;
-        in.open(args.saveFile, ios::binary);
-        if (!in.is_open()) {
-            throw runtime_error("Error opening file" + args.saveFile);
-        }
-        state = loadFluidSimulationState(in);
+        state = loadFluidSimulationState(args.saveFile);
         cout << "Successfully loaded state of simulation, tickCount = "
              << state.tickCount << "." << endl;
     }
+    if (args.seed) {
+        state.seed = *args.seed;
+    }
 
     return state;
 }
 
-void saveStateByArgs(const ConsoleArgs& args,
+namespace {
+
+/// @brief Lines of tune cache, each line is "<key> <p> <v> <v flow>".
+vector<string> readTuneCache(const string& path) {
+    vector<string> lines;
+    ifstream in(path);
+    string line;
+    while (getline(in, line)) {
+        if (!line.empty()) {
+            lines.push_back(line);
+        }
+    }
+    return lines;
+}
+
+bool findCachedTypes(const vector<string>& lines, const string& key,
+                     TypeCombination& types) {
+    auto supported = FluidSimulationFactory::getSupportedTypes();
+    auto isSupported = [&supported](const Type& type) {
+        return find(supported.begin(), supported.end(), type) !=
+               supported.end();
+    };
+    for (const auto& line : lines) {
+        istringstream in(line);
+        string lineKey, p, v, f;
+        if (!(in >> lineKey >> p >> v >> f) || lineKey != key) {
+            continue;
+        }
+        try {
+            types = {parseType(p), parseType(v), parseType(f)};
+        } catch (const invalid_argument&) {
+            return false;
+        }
+        return isSupported(types.pType) && isSupported(types.velocityType) &&
+               isSupported(types.velocityFlowType);
+    }
+    return false;
+}
+
+string formatTypes(const TypeCombination& types) {
+    return "p " + to_string(types.pType) + ", v " +
+           to_string(types.velocityType) + ", v flow " +
+           to_string(types.velocityFlowType);
+}
+
+void replayFrameLog(const ConsoleArgs& args) {
+    FrameLogReader log(args.replayPath);
+    FieldRenderer renderer(cout, args.renderMode, args.asyncRender);
+    while (log.next()) {
+        if (log.getTickCount() < args.seekTick) {
+            continue;
+        }
+        if (log.getTickCount() > args.maxIterations) {
+            break;
+        }
+        if (args.quiet) {
+            renderer.render(log.getTickCount());
+        } else {
+            renderer.render(log.getTickCount(), log.getField());
+        }
+    }
+}
+
+}  // namespace
+
+void replayByArgs(const ConsoleArgs& args) {
+    if (filesystem::is_regular_file(args.replayPath)) {
+        replayFrameLog(args);
+        return;
+    }
+
+    SaveReplay replay(args.replayPath);
+    FieldRenderer renderer(cout, args.renderMode, args.asyncRender);
+    replay.seek(args.seekTick);
+    do {
+        if (replay.getTickCount() > args.maxIterations) {
+            break;
+        }
+        if (args.quiet) {
+            renderer.render(replay.getTickCount());
+        } else {
+            renderer.render(replay.getTickCount(), replay.getState().field);
+        }
+    } while (replay.next());
+}
+
+void tuneTypesByArgs(ConsoleArgs& args, const FluidSimulationState& state) {
+    TuneOptions options;
+    options.steps = args.tuneSteps;
+    options.tolerance = args.tuneTolerance;
+    options.threads = args.threads;
+    options.flowSolver = args.flowSolver;
+
+    ostringstream key;
+    key << hex << getTuneKey(state, options);
+    vector<string> cache;
+    TypeCombination types;
+    if (!args.tuneCache.empty()) {
+        cache = readTuneCache(args.tuneCache);
+        if (findCachedTypes(cache, key.str(), types)) {
+            if (!args.batch) {
+                cout << "Types are loaded from tune cache: "
+                     << formatTypes(types) << "." << endl;
+            }
+            args.pType = types.pType;
+            args.velocityType = types.velocityType;
+            args.velocityFlowType = types.velocityFlowType;
+            return;
+        }
+    }
+
+    auto result = tuneTypes(state, options);
+    if (!args.batch) {
+        for (const auto& candidate : result.candidates) {
+            cout << "Tuning " << formatTypes(candidate.types) << ": ";
+            if (!candidate.error.empty()) {
+                cout << "failed: " << candidate.error << endl;
+                continue;
+            }
+            cout << candidate.getTicksPerSecond() << " ticks/s, "
+                 << candidate.divergence * 100 << "% cells differ." << endl;
+        }
+        cout << "Auto-tuned types: " << formatTypes(result.best) << "."
+             << endl;
+    }
+    args.pType = result.best.pType;
+    args.velocityType = result.best.velocityType;
+    args.velocityFlowType = result.best.velocityFlowType;
+
+    if (!args.tuneCache.empty()) {
+        ofstream out(args.tuneCache);
+        for (const auto& line : cache) {
+            if (line.rfind(key.str() + " ", 0) != 0) {
+                out << line << '\n';
+            }
+        }
+        out << key.str() << " " << to_string(args.pType) << " "
+            << to_string(args.velocityType) << " "
+            << to_string(args.velocityFlowType) << '\n';
+        if (!out) {
+            throw runtime_error("Can't write tune cache " + args.tuneCache +
+                                ".");
+        }
+    }
+}
+
+void runJobsByArgs(const ConsoleArgs& args) {
+    ifstream in(args.jobsFile);
+    if (!in) {
+        throw runtime_error("Error opening file " + args.jobsFile + ".");
+    }
+    auto jobs = parseSimulationJobs(in);
+
+    SimulationRunner runner(args.threads, args.flowSolver, args.maxSteps);
+    auto start = chrono::steady_clock::now();
+    auto results = runner.run(jobs, [&](size_t i, const auto& result) {
+        const auto& job = jobs[i];
+        cout << "Job " << i + 1 << " (" << job.inputFile << ", "
+             << to_string(job.pType) << ", " << to_string(job.velocityType)
+             << ", " << to_string(job.velocityFlowType) << "): ";
+        if (!result.error.empty()) {
+            cout << "failed: " << result.error << endl;
+            return;
+        }
+        cout << result.ticks << " ticks (" << result.steps << " steps) in "
+             << result.seconds << " s, "
+             << (result.seconds > 0 ? result.ticks / result.seconds : 0)
+             << " ticks/s";
+        if (result.truncated) {
+            cout << ", truncated by step limit";
+        }
+        cout << "." << endl;
+    });
+    double seconds =
+        chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+    uint64_t ticks = 0;
+    size_t failed = 0, truncated = 0;
+    for (const auto& result : results) {
+        ticks += result.ticks;
+        failed += !result.error.empty();
+        truncated += result.truncated;
+    }
+    cout << "Ran " << jobs.size() << " jobs (" << failed << " failed, "
+         << truncated << " truncated by step limit) on "
+         << args.threads << " threads: " << ticks << " ticks in " << seconds
+         << " s, " << (seconds > 0 ? ticks / seconds : 0) << " ticks/s."
+         << endl;
+}
+
+string formatSummary(const ConsoleArgs& args, const BatchSummary& summary) {
+    ostringstream out;
+    out << "Types: p " << to_string(args.pType) << ", v "
+        << to_string(args.velocityType) << ", v flow "
+        << to_string(args.velocityFlowType) << ".\n";
+    const char* budget = "tick";
+    if (summary.stop == BatchSummary::Stop::time) {
+        budget = "time";
+    } else if (summary.stop == BatchSummary::Stop::steps) {
+        budget = "step";
+    }
+    out << "Stopped by " << budget << " budget at tick " << summary.lastTick
+        << ".\n";
+    out << "Ran " << summary.ticks << " ticks (" << summary.steps
+        << " steps) in " << summary.seconds << " s, "
+        << (summary.seconds > 0 ? summary.ticks / summary.seconds : 0)
+        << " ticks/s.\n";
+    out << formatProfile(summary.profile);
+    return out.str();
+}
+
+string getSavePath(const ConsoleArgs& args, unsigned tickCount) {
+    return args.saveDir + "/" + to_string(tickCount);
+}
+
+void saveStateByArgs(const ConsoleArgs& args, SaveChain& chain,
                      const FluidSimulationState& state) {
-    string saveFilePath = args.saveDir + "/" + to_string(state.tickCount);
     ofstream out;
-    out.open(saveFilePath, ios::binary);
+    out.open(getSavePath(args, state.tickCount), ios::binary);
     if (!out.is_open()) {
         throw runtime_error("Save error occurred.");
     }
-    saveFluidSimulationState(out, state);
-    cout << "Saved state to file: " << saveFilePath << "." << endl;
-}
\ No newline at end of file
+    chain.save(out, state);
+}
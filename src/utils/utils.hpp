@@ -2,7 +2,36 @@
 
 #include <cli/console_args.hpp>
 #include <simulation/common.hpp>
+#include <simulation/profile.hpp>
+#include <simulation/save_load.hpp>
+#include <string>
 
 FluidSimulationState loadStateByArgs(const ConsoleArgs& args);
-void saveStateByArgs(const ConsoleArgs& args,
-                     const FluidSimulationState& state);
\ No newline at end of file
+/// @brief Print saved ticks of replay dir or frame log from seek tick to
+/// max iterations.
+void replayByArgs(const ConsoleArgs& args);
+/// @brief Choose types of args for state by auto-tuning or take them from
+/// tune cache of args.
+void tuneTypesByArgs(ConsoleArgs& args, const FluidSimulationState& state);
+/// @brief Run simulations of jobs file on threads of args and print result
+/// of each job and total throughput.
+void runJobsByArgs(const ConsoleArgs& args);
+/// @brief Result of batch run.
+struct BatchSummary {
+    // ticks and steps made by run
+    unsigned ticks = 0, steps = 0;
+    unsigned lastTick = 0;
+    double seconds = 0;
+    // budget, that stopped run
+    enum class Stop { ticks, time, steps } stop = Stop::ticks;
+    StepProfile profile;
+};
+
+std::string formatSummary(const ConsoleArgs& args,
+                          const BatchSummary& summary);
+/// @brief Path of save for given tick.
+std::string getSavePath(const ConsoleArgs& args, unsigned tickCount);
+/// @brief Save state to file as next save of chain. Doesn't print anything,
+/// so it can be called from background thread.
+void saveStateByArgs(const ConsoleArgs& args, SaveChain& chain,
+                     const FluidSimulationState& state);
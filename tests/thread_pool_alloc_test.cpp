@@ -0,0 +1,109 @@
+#include <atomic>
+#include <cstdlib>
+#include <iostream>
+#include <new>
+#include <thread/thread_pool.hpp>
+#include <vector>
+
+/*
+Checks, that warmed up ThreadPool doesn't allocate memory for tasks:
+tasks, their deques and free list are reused. Every allocation of process
+is counted by replaced operator new.
+*/
+
+namespace {
+
+std::atomic<size_t> allocations{0};
+
+void* allocate(size_t size, size_t alignment) {
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    size = std::max<size_t>(size, 1);
+    void* ptr = alignment <= alignof(std::max_align_t)
+                    ? std::malloc(size)
+                    : std::aligned_alloc(
+                          alignment, (size + alignment - 1) / alignment *
+                                         alignment);
+    if (!ptr) {
+        throw std::bad_alloc();
+    }
+    return ptr;
+}
+
+}  // namespace
+
+void* operator new(size_t size) {
+    return allocate(size, alignof(std::max_align_t));
+}
+void* operator new(size_t size, std::align_val_t alignment) {
+    return allocate(size, size_t(alignment));
+}
+void operator delete(void* ptr) noexcept { std::free(ptr); }
+void operator delete(void* ptr, size_t) noexcept { std::free(ptr); }
+void operator delete(void* ptr, std::align_val_t) noexcept { std::free(ptr); }
+void operator delete(void* ptr, size_t, std::align_val_t) noexcept {
+    std::free(ptr);
+}
+
+constexpr unsigned poolSize = 2;
+constexpr size_t taskCount = 1000;
+
+/// @brief Submit count void tasks and wait for them.
+void submitTasks(ThreadPool& pool, std::atomic<size_t>& done, size_t count) {
+    for (size_t i = 0; i < count; ++i) {
+        pool.addTask([&done]() { done++; });
+    }
+    pool.waitAll();
+}
+
+bool check(const char* name, size_t count) {
+    if (count != 0) {
+        std::cerr << name << ": " << count << " allocations" << std::endl;
+        return false;
+    }
+    std::cerr << name << ": ok" << std::endl;
+    return true;
+}
+
+int main() {
+    ThreadPool pool(poolSize);
+    std::atomic<size_t> done{0};
+
+    // Warm up with all tasks alive at once, so allocator and deques reach
+    // more than capacity needed later.
+    {
+        std::vector<TaskFuture<void>> futures;
+        futures.reserve(2 * taskCount);
+        for (size_t i = 0; i < 2 * taskCount; ++i) {
+            futures.push_back(pool.addTask([&done]() { done++; }));
+        }
+        pool.waitAll();
+    }
+    pool.parallelFor(0, taskCount, 1, [](size_t) {});
+
+    bool ok = true;
+
+    allocations = 0;
+    submitTasks(pool, done, taskCount);
+    ok &= check("addTask", allocations.load());
+
+    allocations = 0;
+    pool.parallelFor(0, taskCount, 1, [&done](size_t) { done++; });
+    ok &= check("parallelFor", allocations.load());
+
+    if (done != 3 * taskCount + taskCount) {
+        std::cerr << "Not all tasks were run." << std::endl;
+        ok = false;
+    }
+
+    // Pool without threads runs tasks on calling thread.
+    ThreadPool emptyPool(0);
+    done = 0;
+    auto future = emptyPool.addTask([](int x) { return x + 1; }, 1);
+    submitTasks(emptyPool, done, taskCount);
+    emptyPool.parallelFor(0, taskCount, 1, [&done](size_t) { done++; });
+    if (future.get() != 2 || done != 2 * taskCount) {
+        std::cerr << "Pool without threads didn't run tasks." << std::endl;
+        ok = false;
+    }
+    return ok ? 0 : 1;
+}